@@ -0,0 +1,216 @@
+#pragma once
+#include "ConcurrentRedBlackTree.h"
+#include <algorithm>
+#include <functional>
+
+// Counters reported by FlatCombiningRedBlackTree
+struct CombiningStatistics
+{
+    long long batches = 0;    // Times a thread took the combiner role and applied a batch
+    long long operations = 0; // Inserts and removes applied through batches
+};
+
+// Red-Black tree whose writers publish their requests instead of locking the tree themselves
+// Each insert or remove is written to a slot of a publication array (one cache line per slot).
+// Whichever waiting thread gets the combiner lock collects every pending request, sorts them by
+// value and applies the whole batch under one exclusive lock, so consecutive updates walk
+// neighbouring paths that are already in cache; the other writers just wait for their result.
+// Lookups share the tree lock with each other as in ConcurrentRedBlackTree.
+// T must be default constructible to fill the publication slots
+template <class T>
+class FlatCombiningRedBlackTree
+{
+    // Private attributes and helper methods
+private:
+    static const int slotCount = 64;
+    enum RequestState
+    {
+        Empty,   // Free to be claimed
+        Claimed, // Being filled in by its owner
+        Pending, // Waiting for a combiner
+        Done     // Applied; the owner can read the result
+    };
+
+    struct alignas(64) Request
+    {
+        std::atomic<int> state{Empty};
+        bool isInsert = false;
+        T value;
+        bool result = false;
+    };
+
+    RedBlackTree<T> tree;
+    mutable ScalableSharedMutex treeLock;
+    Request requests[slotCount];
+    alignas(64) std::mutex combinerMutex;
+    CombiningStatistics statistics; // Only changed while combinerMutex is held
+    bool publish(bool isInsert, const T &value);
+    void combine();
+
+    // Public methods
+public:
+    FlatCombiningRedBlackTree() = default;
+    FlatCombiningRedBlackTree(const FlatCombiningRedBlackTree<T> &treeParameter) = delete;
+    FlatCombiningRedBlackTree<T> &operator=(const FlatCombiningRedBlackTree<T> &treeParameter) = delete;
+    bool insert(const T valueToStore);
+    bool remove(const T valueToRemove);
+    bool search(const T valueToSearch) const;
+    vector<T> search(const T valueToSearch1, const T valueToSearch2) const;
+    T closestLess(const T valueToCompare) const;
+    T closestGreater(const T valueToCompare) const;
+    vector<T> values() const;
+    int size() const;
+    CombiningStatistics combiningStatistics();
+};
+
+// Publishes a request and waits until some combiner, possibly this thread, has applied it
+// Returns the result of the insert or remove
+template <class T>
+bool FlatCombiningRedBlackTree<T>::publish(bool isInsert, const T &value)
+{
+    // Claim a free slot, starting from one that depends on the thread so threads rarely collide
+    int slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % slotCount;
+    while (true)
+    {
+        int expected = Empty;
+        if (requests[slot].state.load(std::memory_order_relaxed) == Empty &&
+            requests[slot].state.compare_exchange_strong(expected, Claimed, std::memory_order_acquire))
+        {
+            break;
+        }
+        slot = (slot + 1) % slotCount;
+        if (slot == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    Request &request = requests[slot];
+    request.isInsert = isInsert;
+    request.value = value;
+    request.state.store(Pending, std::memory_order_release);
+
+    while (request.state.load(std::memory_order_acquire) != Done)
+    {
+        if (combinerMutex.try_lock())
+        {
+            combine();
+            combinerMutex.unlock();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    bool result = request.result;
+    request.state.store(Empty, std::memory_order_release);
+    return result;
+}
+
+// Applies every pending request in ascending value order
+// Must be called with combinerMutex held
+template <class T>
+void FlatCombiningRedBlackTree<T>::combine()
+{
+    vector<Request *> batch;
+    for (Request &request : requests)
+    {
+        if (request.state.load(std::memory_order_acquire) == Pending)
+        {
+            batch.push_back(&request);
+        }
+    }
+    if (batch.empty())
+    {
+        return;
+    }
+
+    // Requests for the same value keep their slot order
+    std::stable_sort(batch.begin(), batch.end(), [](const Request *first, const Request *second)
+                     { return first->value < second->value; });
+    {
+        std::lock_guard<ScalableSharedMutex> guard(treeLock);
+        for (Request *request : batch)
+        {
+            request->result = request->isInsert ? tree.insert(request->value) : tree.remove(request->value);
+        }
+    }
+    for (Request *request : batch)
+    {
+        request->state.store(Done, std::memory_order_release);
+    }
+    statistics.batches++;
+    statistics.operations += batch.size();
+}
+
+// Inserts the value parameter
+// Returns true on success or false if the value is already present
+template <class T>
+bool FlatCombiningRedBlackTree<T>::insert(const T valueToStore)
+{
+    return publish(true, valueToStore);
+}
+
+// Removes the value parameter
+// Returns true on success or false if the value is not present
+template <class T>
+bool FlatCombiningRedBlackTree<T>::remove(const T valueToRemove)
+{
+    return publish(false, valueToRemove);
+}
+
+// Searches the tree for the provided parameter
+// Returns true if found, false otherwise
+template <class T>
+bool FlatCombiningRedBlackTree<T>::search(const T valueToSearch) const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.search(valueToSearch);
+}
+
+// Returns a vector containing values between the method's first and second parameters
+template <class T>
+vector<T> FlatCombiningRedBlackTree<T>::search(const T valueToSearch1, const T valueToSearch2) const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.search(valueToSearch1, valueToSearch2);
+}
+
+// Returns the largest value in the tree that is less than the parameter
+template <class T>
+T FlatCombiningRedBlackTree<T>::closestLess(const T valueToCompare) const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.closestLess(valueToCompare);
+}
+
+// Returns the smallest value in the tree that is greater than the parameter
+template <class T>
+T FlatCombiningRedBlackTree<T>::closestGreater(const T valueToCompare) const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.closestGreater(valueToCompare);
+}
+
+// Returns a vector containing all of the values in the tree
+template <class T>
+vector<T> FlatCombiningRedBlackTree<T>::values() const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.values();
+}
+
+// Returns the size of the tree
+template <class T>
+int FlatCombiningRedBlackTree<T>::size() const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.size();
+}
+
+// Returns the number of batches applied and the operations they contained
+template <class T>
+CombiningStatistics FlatCombiningRedBlackTree<T>::combiningStatistics()
+{
+    std::lock_guard<std::mutex> guard(combinerMutex);
+    return statistics;
+}
@@ -0,0 +1,553 @@
+#pragma once
+#include <atomic>
+#include <initializer_list>
+#include <thread>
+#include <vector>
+using std::vector;
+
+// Small test-and-test-and-set lock; node critical sections are only a few instructions long
+class SpinLock
+{
+private:
+    std::atomic<bool> locked{false};
+
+public:
+    void lock()
+    {
+        while (locked.exchange(true, std::memory_order_acquire))
+        {
+            while (locked.load(std::memory_order_relaxed))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+    void unlock()
+    {
+        locked.store(false, std::memory_order_release);
+    }
+};
+
+// LockedNodeT class
+template <class T>
+class LockedNodeT
+{
+public:
+    T data;
+    LockedNodeT<T> *children[2]; // children[0] is the left child, children[1] the right child
+    bool isBlack;
+    SpinLock nodeLock;
+
+    // LockedNodeT Constructor
+    LockedNodeT(T value) : data(std::move(value)), children{nullptr, nullptr}, isBlack(false){};
+};
+
+// Red-Black tree whose writers rebalance top-down in a single pass while holding
+// only a small window of node locks (hand-over-hand lock coupling)
+// Bottom-up fixes can rotate all the way back to the root, so they need a global lock;
+// top-down insertion and deletion never revisit a node they have left, so writers working in
+// different key regions only meet near the root and otherwise proceed in parallel.
+// Locks are always taken parent before child, which rules out deadlock.
+// T must be default constructible for the sentinel node above the root
+template <class T>
+class LockCouplingRedBlackTree
+{
+    // Private attributes and helper methods
+private:
+    // Locks held by one operation
+    class LockWindow
+    {
+    private:
+        LockedNodeT<T> *heldNodes[16];
+        int heldCount = 0;
+
+    public:
+        void acquire(LockedNodeT<T> *node);
+        void release(LockedNodeT<T> *node);
+        void releaseExcept(std::initializer_list<LockedNodeT<T> *> nodesToKeep);
+        ~LockWindow();
+    };
+
+    LockedNodeT<T> head; // Sentinel whose right child is the root
+    std::atomic<int> treeSize;
+    static bool isRed(const LockedNodeT<T> *node);
+    static LockedNodeT<T> *rotateSingle(LockedNodeT<T> *subtreeRoot, int direction);
+    static LockedNodeT<T> *rotateDouble(LockedNodeT<T> *subtreeRoot, int direction);
+    void deleteTree(LockedNodeT<T> *treeNode);
+    bool nextValue(const T *lowerBound, bool includeBound, T &foundValue) const;
+
+    // Public methods
+public:
+    LockCouplingRedBlackTree();
+    LockCouplingRedBlackTree(const LockCouplingRedBlackTree<T> &treeParameter) = delete;
+    LockCouplingRedBlackTree<T> &operator=(const LockCouplingRedBlackTree<T> &treeParameter) = delete;
+    ~LockCouplingRedBlackTree();
+    bool insert(const T valueToStore);
+    bool remove(const T valueToRemove);
+    bool search(const T valueToSearch) const;
+    vector<T> search(const T valueToSearch1, const T valueToSearch2) const;
+    T closestLess(const T valueToCompare) const;
+    T closestGreater(const T valueToCompare) const;
+    vector<T> values() const;
+    int size() const;
+    template <class Tjwme>
+    friend LockedNodeT<Tjwme> *getTreeRoot(const LockCouplingRedBlackTree<Tjwme> &rbt);
+};
+
+// Locks the node unless it is null or already held
+template <class T>
+void LockCouplingRedBlackTree<T>::LockWindow::acquire(LockedNodeT<T> *node)
+{
+    if (node == nullptr)
+    {
+        return;
+    }
+    for (int i = 0; i < heldCount; i++)
+    {
+        if (heldNodes[i] == node)
+        {
+            return;
+        }
+    }
+    node->nodeLock.lock();
+    heldNodes[heldCount++] = node;
+}
+
+// Unlocks one held node
+template <class T>
+void LockCouplingRedBlackTree<T>::LockWindow::release(LockedNodeT<T> *node)
+{
+    for (int i = 0; i < heldCount; i++)
+    {
+        if (heldNodes[i] == node)
+        {
+            node->nodeLock.unlock();
+            heldNodes[i] = heldNodes[--heldCount];
+            return;
+        }
+    }
+}
+
+// Unlocks every held node that is not in the list
+template <class T>
+void LockCouplingRedBlackTree<T>::LockWindow::releaseExcept(std::initializer_list<LockedNodeT<T> *> nodesToKeep)
+{
+    int keptCount = 0;
+    for (int i = 0; i < heldCount; i++)
+    {
+        bool keep = false;
+        for (LockedNodeT<T> *nodeToKeep : nodesToKeep)
+        {
+            keep = keep || heldNodes[i] == nodeToKeep;
+        }
+        if (keep)
+        {
+            heldNodes[keptCount++] = heldNodes[i];
+        }
+        else
+        {
+            heldNodes[i]->nodeLock.unlock();
+        }
+    }
+    heldCount = keptCount;
+}
+
+// Unlocks everything still held when the operation ends
+template <class T>
+LockCouplingRedBlackTree<T>::LockWindow::~LockWindow()
+{
+    for (int i = 0; i < heldCount; i++)
+    {
+        heldNodes[i]->nodeLock.unlock();
+    }
+}
+
+// Constructor
+template <class T>
+LockCouplingRedBlackTree<T>::LockCouplingRedBlackTree() : head(T()), treeSize(0)
+{
+    head.isBlack = true;
+}
+
+// Destructor
+template <class T>
+LockCouplingRedBlackTree<T>::~LockCouplingRedBlackTree()
+{
+    deleteTree(head.children[1]);
+}
+
+// Deallocates the subtree
+template <class T>
+void LockCouplingRedBlackTree<T>::deleteTree(LockedNodeT<T> *treeNode)
+{
+    if (treeNode != nullptr)
+    {
+        deleteTree(treeNode->children[0]);
+        deleteTree(treeNode->children[1]);
+        delete treeNode;
+    }
+}
+
+// Returns true if the node is red; missing (null) children count as black
+template <class T>
+bool LockCouplingRedBlackTree<T>::isRed(const LockedNodeT<T> *node)
+{
+    return node != nullptr && !node->isBlack;
+}
+
+// Rotates the subtree towards the given direction and returns its new root
+// The old root turns red and the new root black
+template <class T>
+LockedNodeT<T> *LockCouplingRedBlackTree<T>::rotateSingle(LockedNodeT<T> *subtreeRoot, int direction)
+{
+    LockedNodeT<T> *newRoot = subtreeRoot->children[!direction];
+    subtreeRoot->children[!direction] = newRoot->children[direction];
+    newRoot->children[direction] = subtreeRoot;
+    subtreeRoot->isBlack = false;
+    newRoot->isBlack = true;
+    return newRoot;
+}
+
+// Rotates the child the other way first, then the subtree towards the given direction
+template <class T>
+LockedNodeT<T> *LockCouplingRedBlackTree<T>::rotateDouble(LockedNodeT<T> *subtreeRoot, int direction)
+{
+    subtreeRoot->children[!direction] = rotateSingle(subtreeRoot->children[!direction], !direction);
+    return rotateSingle(subtreeRoot, direction);
+}
+
+// Inserts the value parameter into the tree
+// Returns true on success or false if the value is already present
+template <class T>
+bool LockCouplingRedBlackTree<T>::insert(const T valueToStore)
+{
+    LockWindow window;
+    window.acquire(&head);
+    if (head.children[1] == nullptr)
+    {
+        head.children[1] = new LockedNodeT<T>(valueToStore);
+        head.children[1]->isBlack = true;
+        treeSize.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    window.acquire(head.children[1]);
+    head.children[1]->isBlack = true;
+
+    // greatGrandParent, grandParent, parentNode and currentNode form the locked window;
+    // colour flips and rotations only ever touch nodes inside it
+    LockedNodeT<T> *greatGrandParent = &head;
+    LockedNodeT<T> *grandParent = nullptr;
+    LockedNodeT<T> *parentNode = nullptr;
+    LockedNodeT<T> *currentNode = head.children[1];
+    int direction = 0;
+    int lastDirection = 0;
+    bool inserted = false;
+
+    while (true)
+    {
+        if (currentNode == nullptr)
+        {
+            // Attach the new red leaf
+            currentNode = new LockedNodeT<T>(valueToStore);
+            parentNode->children[direction] = currentNode;
+            window.acquire(currentNode);
+            inserted = true;
+        }
+        else
+        {
+            // A black node with two red children becomes red with two black children
+            window.acquire(currentNode->children[0]);
+            window.acquire(currentNode->children[1]);
+            if (isRed(currentNode->children[0]) && isRed(currentNode->children[1]))
+            {
+                currentNode->isBlack = false;
+                currentNode->children[0]->isBlack = true;
+                currentNode->children[1]->isBlack = true;
+            }
+        }
+
+        // Two reds in a row are fixed by rotating the grandparent
+        if (isRed(currentNode) && isRed(parentNode))
+        {
+            int grandParentDirection = greatGrandParent->children[1] == grandParent;
+            if (currentNode == parentNode->children[lastDirection])
+            {
+                greatGrandParent->children[grandParentDirection] = rotateSingle(grandParent, !lastDirection);
+            }
+            else
+            {
+                greatGrandParent->children[grandParentDirection] = rotateDouble(grandParent, !lastDirection);
+            }
+        }
+
+        if (currentNode->data == valueToStore)
+        {
+            break;
+        }
+
+        // Slide the window one level down
+        lastDirection = direction;
+        direction = currentNode->data < valueToStore;
+        if (grandParent != nullptr)
+        {
+            greatGrandParent = grandParent;
+        }
+        grandParent = parentNode;
+        parentNode = currentNode;
+        currentNode = currentNode->children[direction];
+        window.releaseExcept({greatGrandParent, grandParent, parentNode, currentNode});
+    }
+
+    if (inserted)
+    {
+        treeSize.fetch_add(1, std::memory_order_relaxed);
+    }
+    return inserted;
+}
+
+// Removes the value parameter from the tree
+// Returns true on success or false if the value is not present
+template <class T>
+bool LockCouplingRedBlackTree<T>::remove(const T valueToRemove)
+{
+    LockWindow window;
+    window.acquire(&head);
+    if (head.children[1] == nullptr)
+    {
+        return false;
+    }
+    window.acquire(head.children[1]);
+    head.children[1]->isBlack = true;
+
+    // Walk down pushing a red node ahead of us, so the node finally unlinked is red
+    // foundNode stays locked until its value has been replaced by its predecessor
+    LockedNodeT<T> *grandParent = nullptr;
+    LockedNodeT<T> *parentNode = nullptr;
+    LockedNodeT<T> *currentNode = &head;
+    LockedNodeT<T> *foundNode = nullptr;
+    int direction = 1;
+
+    while (currentNode->children[direction] != nullptr)
+    {
+        int lastDirection = direction;
+        grandParent = parentNode;
+        parentNode = currentNode;
+        currentNode = currentNode->children[direction];
+        window.releaseExcept({grandParent, parentNode, currentNode, foundNode});
+
+        direction = currentNode->data < valueToRemove;
+        if (currentNode->data == valueToRemove)
+        {
+            foundNode = currentNode;
+        }
+
+        window.acquire(currentNode->children[0]);
+        window.acquire(currentNode->children[1]);
+        if (!isRed(currentNode) && !isRed(currentNode->children[direction]))
+        {
+            if (isRed(currentNode->children[!direction]))
+            {
+                // Rotate the red child above the current node
+                parentNode->children[lastDirection] = rotateSingle(currentNode, direction);
+                parentNode = parentNode->children[lastDirection];
+            }
+            else
+            {
+                LockedNodeT<T> *siblingNode = parentNode->children[!lastDirection];
+                if (siblingNode != nullptr)
+                {
+                    window.acquire(siblingNode);
+                    window.acquire(siblingNode->children[0]);
+                    window.acquire(siblingNode->children[1]);
+                    if (!isRed(siblingNode->children[!lastDirection]) && !isRed(siblingNode->children[lastDirection]))
+                    {
+                        // Colour flip
+                        parentNode->isBlack = true;
+                        siblingNode->isBlack = false;
+                        currentNode->isBlack = false;
+                    }
+                    else
+                    {
+                        // Borrow a red node from the sibling's side
+                        int parentDirection = grandParent->children[1] == parentNode;
+                        if (isRed(siblingNode->children[lastDirection]))
+                        {
+                            grandParent->children[parentDirection] = rotateDouble(parentNode, lastDirection);
+                        }
+                        else
+                        {
+                            grandParent->children[parentDirection] = rotateSingle(parentNode, lastDirection);
+                        }
+
+                        LockedNodeT<T> *newSubtreeRoot = grandParent->children[parentDirection];
+                        currentNode->isBlack = false;
+                        newSubtreeRoot->isBlack = false;
+                        newSubtreeRoot->children[0]->isBlack = true;
+                        newSubtreeRoot->children[1]->isBlack = true;
+                    }
+                }
+            }
+        }
+    }
+
+    if (foundNode == nullptr)
+    {
+        return false;
+    }
+
+    // currentNode is the predecessor (or the node itself) and has at most one child
+    foundNode->data = currentNode->data;
+    parentNode->children[parentNode->children[1] == currentNode] = currentNode->children[currentNode->children[0] == nullptr];
+
+    // Nobody can be waiting for the unlinked node, since reaching it requires its parent's lock
+    window.release(currentNode);
+    delete currentNode;
+    treeSize.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Searches the tree for the provided parameter, holding at most two locks at a time
+// Returns true if found, false otherwise
+template <class T>
+bool LockCouplingRedBlackTree<T>::search(const T valueToSearch) const
+{
+    LockedNodeT<T> *parentNode = const_cast<LockedNodeT<T> *>(&head);
+    parentNode->nodeLock.lock();
+    LockedNodeT<T> *currentNode = parentNode->children[1];
+    while (currentNode != nullptr)
+    {
+        currentNode->nodeLock.lock();
+        parentNode->nodeLock.unlock();
+        if (valueToSearch == currentNode->data)
+        {
+            currentNode->nodeLock.unlock();
+            return true;
+        }
+        parentNode = currentNode;
+        currentNode = currentNode->children[currentNode->data < valueToSearch];
+    }
+    parentNode->nodeLock.unlock();
+    return false;
+}
+
+// Returns the largest value in the tree that is less than the parameter
+// Returns the parameter if there is no such value
+template <class T>
+T LockCouplingRedBlackTree<T>::closestLess(const T valueToCompare) const
+{
+    T closestValue = valueToCompare;
+    LockedNodeT<T> *parentNode = const_cast<LockedNodeT<T> *>(&head);
+    parentNode->nodeLock.lock();
+    LockedNodeT<T> *currentNode = parentNode->children[1];
+    while (currentNode != nullptr)
+    {
+        currentNode->nodeLock.lock();
+        parentNode->nodeLock.unlock();
+        bool isLess = currentNode->data < valueToCompare;
+        if (isLess)
+        {
+            closestValue = currentNode->data;
+        }
+        parentNode = currentNode;
+        currentNode = currentNode->children[isLess];
+    }
+    parentNode->nodeLock.unlock();
+    return closestValue;
+}
+
+// Returns the smallest value in the tree that is greater than the parameter
+// Returns the parameter if there is no such value
+template <class T>
+T LockCouplingRedBlackTree<T>::closestGreater(const T valueToCompare) const
+{
+    T closestValue = valueToCompare;
+    LockedNodeT<T> *parentNode = const_cast<LockedNodeT<T> *>(&head);
+    parentNode->nodeLock.lock();
+    LockedNodeT<T> *currentNode = parentNode->children[1];
+    while (currentNode != nullptr)
+    {
+        currentNode->nodeLock.lock();
+        parentNode->nodeLock.unlock();
+        bool isGreater = currentNode->data > valueToCompare;
+        if (isGreater)
+        {
+            closestValue = currentNode->data;
+        }
+        parentNode = currentNode;
+        currentNode = currentNode->children[!isGreater];
+    }
+    parentNode->nodeLock.unlock();
+    return closestValue;
+}
+
+// Returns a vector containing values between the method's first and second parameters
+// Each value is found by its own hand-over-hand descent holding at most two locks, so a long
+// scan never keeps writers waiting for more than one step. It costs O(k log n) for k values, and
+// while writers are active the result is not a snapshot: every value was present when it was read
+template <class T>
+vector<T> LockCouplingRedBlackTree<T>::search(const T valueToSearch1, const T valueToSearch2) const
+{
+    const T &lowerValue = valueToSearch1 > valueToSearch2 ? valueToSearch2 : valueToSearch1;
+    const T &higherValue = valueToSearch1 > valueToSearch2 ? valueToSearch1 : valueToSearch2;
+    vector<T> treeValuesInRange;
+    T currentValue;
+    bool found = nextValue(&lowerValue, true, currentValue);
+    while (found && currentValue <= higherValue)
+    {
+        treeValuesInRange.push_back(currentValue);
+        found = nextValue(&treeValuesInRange.back(), false, currentValue);
+    }
+    return treeValuesInRange;
+}
+
+// Finds the smallest value that is greater than lowerBound (or equal to it, if includeBound is true),
+// or the smallest value of all when lowerBound is null, holding at most two locks at a time
+// Returns true and stores the value in foundValue, or false if there is none
+template <class T>
+bool LockCouplingRedBlackTree<T>::nextValue(const T *lowerBound, bool includeBound, T &foundValue) const
+{
+    bool found = false;
+    LockedNodeT<T> *parentNode = const_cast<LockedNodeT<T> *>(&head);
+    parentNode->nodeLock.lock();
+    LockedNodeT<T> *currentNode = parentNode->children[1];
+    while (currentNode != nullptr)
+    {
+        currentNode->nodeLock.lock();
+        parentNode->nodeLock.unlock();
+        bool isCandidate = lowerBound == nullptr ||
+                           (includeBound ? !(currentNode->data < *lowerBound) : *lowerBound < currentNode->data);
+        if (isCandidate)
+        {
+            foundValue = currentNode->data;
+            found = true;
+        }
+        parentNode = currentNode;
+        currentNode = currentNode->children[!isCandidate];
+    }
+    parentNode->nodeLock.unlock();
+    return found;
+}
+
+// Returns a vector containing all of the values in the tree in ascending order
+// Like the range search, it never blocks writers for more than one step and is not a snapshot
+template <class T>
+vector<T> LockCouplingRedBlackTree<T>::values() const
+{
+    vector<T> treeValues;
+    treeValues.reserve(size());
+    T currentValue;
+    bool found = nextValue(nullptr, true, currentValue);
+    while (found)
+    {
+        treeValues.push_back(currentValue);
+        found = nextValue(&treeValues.back(), false, currentValue);
+    }
+    return treeValues;
+}
+
+// Returns the number of values in the tree
+template <class T>
+int LockCouplingRedBlackTree<T>::size() const
+{
+    return treeSize.load(std::memory_order_relaxed);
+}
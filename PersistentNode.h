@@ -0,0 +1,401 @@
+#pragma once
+#include <atomic>
+#include <vector>
+using std::vector;
+
+// PersistentNodeT class
+// Nodes never change after they are built, so any number of tree versions can share them
+// and readers can walk them without locks; an update copies only the root-to-leaf path it touches
+template <class T>
+class PersistentNodeT
+{
+public:
+    const T data;
+    PersistentNodeT<T> *const left;
+    PersistentNodeT<T> *const right;
+    const bool isBlack;
+    std::atomic<int> referenceCount; // Number of parents and tree versions that hold the node
+
+    // PersistentNodeT Constructor
+    // The new node adopts one reference to each child
+    PersistentNodeT(bool black, PersistentNodeT<T> *leftChild, const T &value, PersistentNodeT<T> *rightChild)
+        : data(value), left(leftChild), right(rightChild), isBlack(black), referenceCount(1){};
+};
+
+// Counted reference to a PersistentNodeT
+// When the last reference goes away the node releases its children and is handed to
+// Reclaimer::dispose, which either frees it at once or defers the free until readers are done
+template <class T, class Reclaimer>
+class PersistentNodeRef
+{
+    // Private attributes
+private:
+    PersistentNodeT<T> *node;
+
+    // Public methods
+public:
+    PersistentNodeRef() : node(nullptr){};
+    PersistentNodeRef(const PersistentNodeRef<T, Reclaimer> &other) : node(other.node)
+    {
+        retain(node);
+    }
+    PersistentNodeRef(PersistentNodeRef<T, Reclaimer> &&other) noexcept : node(other.node)
+    {
+        other.node = nullptr;
+    }
+    PersistentNodeRef<T, Reclaimer> &operator=(PersistentNodeRef<T, Reclaimer> other) noexcept
+    {
+        PersistentNodeT<T> *oldNode = node;
+        node = other.node;
+        other.node = oldNode;
+        return *this;
+    }
+    ~PersistentNodeRef()
+    {
+        release(node);
+    }
+
+    PersistentNodeT<T> *get() const { return node; }
+    PersistentNodeT<T> *operator->() const { return node; }
+    bool isNull() const { return node == nullptr; }
+
+    // Wraps a node whose reference the caller already owns
+    static PersistentNodeRef<T, Reclaimer> adopt(PersistentNodeT<T> *ownedNode)
+    {
+        PersistentNodeRef<T, Reclaimer> nodeRef;
+        nodeRef.node = ownedNode;
+        return nodeRef;
+    }
+
+    // Takes a new reference to a node that is already held elsewhere
+    static PersistentNodeRef<T, Reclaimer> share(PersistentNodeT<T> *sharedNode)
+    {
+        retain(sharedNode);
+        return adopt(sharedNode);
+    }
+
+    // Gives up ownership of the node without releasing it
+    PersistentNodeT<T> *detach()
+    {
+        PersistentNodeT<T> *detachedNode = node;
+        node = nullptr;
+        return detachedNode;
+    }
+
+    static void retain(PersistentNodeT<T> *nodeToRetain)
+    {
+        if (nodeToRetain != nullptr)
+        {
+            nodeToRetain->referenceCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static void release(PersistentNodeT<T> *nodeToRelease)
+    {
+        if (nodeToRelease != nullptr && nodeToRelease->referenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            release(nodeToRelease->left);
+            release(nodeToRelease->right);
+            Reclaimer::dispose(nodeToRelease);
+        }
+    }
+};
+
+// Reclaimer that frees a node as soon as its last reference goes away
+// Suitable whenever no reader can be walking a version without holding a reference to it
+template <class T>
+class ImmediateReclaimer
+{
+public:
+    static void dispose(PersistentNodeT<T> *nodeToDispose)
+    {
+        delete nodeToDispose;
+    }
+};
+
+// Path-copying Red-Black tree algorithms (after Kahrs' functional insertion and deletion)
+// Every function returns a new version and leaves the versions it was given untouched
+template <class T, class Reclaimer>
+class PersistentRedBlackOps
+{
+public:
+    using Ref = PersistentNodeRef<T, Reclaimer>;
+
+    // Builds a node from two child references
+    static Ref makeNode(bool black, Ref left, const T &value, Ref right)
+    {
+        return Ref::adopt(new PersistentNodeT<T>(black, left.detach(), value, right.detach()));
+    }
+
+    static bool isRed(const PersistentNodeT<T> *node)
+    {
+        return node != nullptr && !node->isBlack;
+    }
+
+    static Ref leftOf(const Ref &node) { return Ref::share(node->left); }
+    static Ref rightOf(const Ref &node) { return Ref::share(node->right); }
+
+    // Returns the tree with the value inserted; the value must not already be present
+    static Ref insert(const Ref &tree, const T &value)
+    {
+        return blacken(insertInto(tree, value));
+    }
+
+    // Returns the tree with the value removed; the value must be present
+    static Ref remove(const Ref &tree, const T &value)
+    {
+        return blacken(removeFrom(tree, value));
+    }
+
+    // Returns the node holding the value, or nullptr if there is none
+    static const PersistentNodeT<T> *find(const PersistentNodeT<T> *currentNode, const T &value)
+    {
+        while (currentNode != nullptr)
+        {
+            if (value == currentNode->data)
+            {
+                return currentNode;
+            }
+            currentNode = value < currentNode->data ? currentNode->left : currentNode->right;
+        }
+        return nullptr;
+    }
+
+    // Returns the node with the largest value less than the parameter, or nullptr if there is none
+    static const PersistentNodeT<T> *closestLess(const PersistentNodeT<T> *currentNode, const T &value)
+    {
+        const PersistentNodeT<T> *closestNode = nullptr;
+        while (currentNode != nullptr)
+        {
+            if (currentNode->data < value)
+            {
+                closestNode = currentNode;
+                currentNode = currentNode->right;
+            }
+            else
+            {
+                currentNode = currentNode->left;
+            }
+        }
+        return closestNode;
+    }
+
+    // Returns the node with the smallest value greater than the parameter, or nullptr if there is none
+    static const PersistentNodeT<T> *closestGreater(const PersistentNodeT<T> *currentNode, const T &value)
+    {
+        const PersistentNodeT<T> *closestNode = nullptr;
+        while (currentNode != nullptr)
+        {
+            if (currentNode->data > value)
+            {
+                closestNode = currentNode;
+                currentNode = currentNode->left;
+            }
+            else
+            {
+                currentNode = currentNode->right;
+            }
+        }
+        return closestNode;
+    }
+
+    // Appends the values of the subtree between the two bounds to treeValues in ascending order
+    static void rangeSearch(const PersistentNodeT<T> *currentNode, const T &lowerValue, const T &higherValue, vector<T> &treeValues)
+    {
+        if (currentNode == nullptr)
+        {
+            return;
+        }
+        if (lowerValue < currentNode->data)
+        {
+            rangeSearch(currentNode->left, lowerValue, higherValue, treeValues);
+        }
+        if (lowerValue <= currentNode->data && higherValue >= currentNode->data)
+        {
+            treeValues.push_back(currentNode->data);
+        }
+        if (higherValue > currentNode->data)
+        {
+            rangeSearch(currentNode->right, lowerValue, higherValue, treeValues);
+        }
+    }
+
+    // Appends all of the values of the subtree to treeValues in ascending order
+    static void inOrderValues(const PersistentNodeT<T> *currentNode, vector<T> &treeValues)
+    {
+        if (currentNode == nullptr)
+        {
+            return;
+        }
+        inOrderValues(currentNode->left, treeValues);
+        treeValues.push_back(currentNode->data);
+        inOrderValues(currentNode->right, treeValues);
+    }
+
+    // Private helper methods
+private:
+    static Ref blacken(const Ref &tree)
+    {
+        if (isRed(tree.get()))
+        {
+            return makeNode(true, leftOf(tree), tree->data, rightOf(tree));
+        }
+        return tree;
+    }
+
+    // Turns a black node red; used when a subtree is one black level too tall
+    static Ref redden(const Ref &tree)
+    {
+        return makeNode(false, leftOf(tree), tree->data, rightOf(tree));
+    }
+
+    // Rebuilds a black node whose children may hold a red-red violation
+    static Ref balance(const Ref &left, const T &value, const Ref &right)
+    {
+        if (isRed(left.get()) && isRed(right.get()))
+        {
+            return makeNode(false, makeNode(true, leftOf(left), left->data, rightOf(left)), value,
+                            makeNode(true, leftOf(right), right->data, rightOf(right)));
+        }
+        if (isRed(left.get()) && isRed(left->left))
+        {
+            Ref outer = leftOf(left);
+            return makeNode(false, makeNode(true, leftOf(outer), outer->data, rightOf(outer)), left->data,
+                            makeNode(true, rightOf(left), value, right));
+        }
+        if (isRed(left.get()) && isRed(left->right))
+        {
+            Ref inner = rightOf(left);
+            return makeNode(false, makeNode(true, leftOf(left), left->data, leftOf(inner)), inner->data,
+                            makeNode(true, rightOf(inner), value, right));
+        }
+        if (isRed(right.get()) && isRed(right->right))
+        {
+            Ref outer = rightOf(right);
+            return makeNode(false, makeNode(true, left, value, leftOf(right)), right->data,
+                            makeNode(true, leftOf(outer), outer->data, rightOf(outer)));
+        }
+        if (isRed(right.get()) && isRed(right->left))
+        {
+            Ref inner = leftOf(right);
+            return makeNode(false, makeNode(true, left, value, leftOf(inner)), inner->data,
+                            makeNode(true, rightOf(inner), right->data, rightOf(right)));
+        }
+        return makeNode(true, left, value, right);
+    }
+
+    static Ref insertInto(const Ref &tree, const T &value)
+    {
+        if (tree.isNull())
+        {
+            return makeNode(false, Ref(), value, Ref());
+        }
+        if (value < tree->data)
+        {
+            Ref newLeft = insertInto(leftOf(tree), value);
+            return tree->isBlack ? balance(newLeft, tree->data, rightOf(tree))
+                                 : makeNode(false, newLeft, tree->data, rightOf(tree));
+        }
+        Ref newRight = insertInto(rightOf(tree), value);
+        return tree->isBlack ? balance(leftOf(tree), tree->data, newRight)
+                             : makeNode(false, leftOf(tree), tree->data, newRight);
+    }
+
+    static Ref removeFrom(const Ref &tree, const T &value)
+    {
+        if (tree.isNull())
+        {
+            return Ref();
+        }
+        if (value < tree->data)
+        {
+            // Removing from a black subtree shortens it, which balanceLeft repairs
+            Ref newLeft = removeFrom(leftOf(tree), value);
+            if (tree->left != nullptr && tree->left->isBlack)
+            {
+                return balanceLeft(newLeft, tree->data, rightOf(tree));
+            }
+            return makeNode(false, newLeft, tree->data, rightOf(tree));
+        }
+        if (value > tree->data)
+        {
+            Ref newRight = removeFrom(rightOf(tree), value);
+            if (tree->right != nullptr && tree->right->isBlack)
+            {
+                return balanceRight(leftOf(tree), tree->data, newRight);
+            }
+            return makeNode(false, leftOf(tree), tree->data, newRight);
+        }
+        return join(leftOf(tree), rightOf(tree));
+    }
+
+    // Rebuilds a node whose left subtree is one black level shorter than its right subtree
+    static Ref balanceLeft(const Ref &left, const T &value, const Ref &right)
+    {
+        if (isRed(left.get()))
+        {
+            return makeNode(false, makeNode(true, leftOf(left), left->data, rightOf(left)), value, right);
+        }
+        if (!right.isNull() && right->isBlack)
+        {
+            return balance(left, value, redden(right));
+        }
+        Ref inner = leftOf(right);
+        return makeNode(false, makeNode(true, left, value, leftOf(inner)), inner->data,
+                        balance(rightOf(inner), right->data, redden(rightOf(right))));
+    }
+
+    // Rebuilds a node whose right subtree is one black level shorter than its left subtree
+    static Ref balanceRight(const Ref &left, const T &value, const Ref &right)
+    {
+        if (isRed(right.get()))
+        {
+            return makeNode(false, left, value, makeNode(true, leftOf(right), right->data, rightOf(right)));
+        }
+        if (!left.isNull() && left->isBlack)
+        {
+            return balance(redden(left), value, right);
+        }
+        Ref inner = rightOf(left);
+        return makeNode(false, balance(redden(leftOf(left)), left->data, leftOf(inner)), inner->data,
+                        makeNode(true, rightOf(inner), value, right));
+    }
+
+    // Joins two subtrees of equal black height whose values are all in order
+    static Ref join(const Ref &left, const Ref &right)
+    {
+        if (left.isNull())
+        {
+            return right;
+        }
+        if (right.isNull())
+        {
+            return left;
+        }
+        if (isRed(left.get()) && isRed(right.get()))
+        {
+            Ref middle = join(rightOf(left), leftOf(right));
+            if (isRed(middle.get()))
+            {
+                return makeNode(false, makeNode(false, leftOf(left), left->data, leftOf(middle)), middle->data,
+                                makeNode(false, rightOf(middle), right->data, rightOf(right)));
+            }
+            return makeNode(false, leftOf(left), left->data, makeNode(false, middle, right->data, rightOf(right)));
+        }
+        if (!isRed(left.get()) && !isRed(right.get()))
+        {
+            Ref middle = join(rightOf(left), leftOf(right));
+            if (isRed(middle.get()))
+            {
+                return makeNode(false, makeNode(true, leftOf(left), left->data, leftOf(middle)), middle->data,
+                                makeNode(true, rightOf(middle), right->data, rightOf(right)));
+            }
+            return balanceLeft(leftOf(left), left->data, makeNode(true, middle, right->data, rightOf(right)));
+        }
+        if (isRed(right.get()))
+        {
+            return makeNode(false, join(left, leftOf(right)), right->data, rightOf(right));
+        }
+        return makeNode(false, leftOf(left), left->data, join(rightOf(left), right));
+    }
+};
@@ -0,0 +1,136 @@
+#pragma once
+#include "PersistentNode.h"
+
+// Red-Black tree whose copies share structure
+// insert and remove copy only the O(log n) path they change and share the rest of the nodes,
+// which are immutable and reference counted. Copying or assigning a tree just shares its root,
+// so both take O(1) and later updates to either copy never show up in the other.
+// Different copies can be used from different threads, since shared nodes are never modified
+// and their counts are atomic; a single copy is not thread-safe
+template <class T>
+class PersistentRedBlackTree
+{
+    // Private attributes
+private:
+    using Ops = PersistentRedBlackOps<T, ImmediateReclaimer<T>>;
+    using Ref = PersistentNodeRef<T, ImmediateReclaimer<T>>;
+
+    Ref root;
+    int treeSize;
+
+    // Public methods
+public:
+    PersistentRedBlackTree();
+    bool insert(const T valueToStore);
+    bool remove(const T valueToRemove);
+    bool search(const T valueToSearch) const;
+    vector<T> search(const T valueToSearch1, const T valueToSearch2) const;
+    T closestLess(const T valueToCompare) const;
+    T closestGreater(const T valueToCompare) const;
+    vector<T> values() const;
+    int size() const;
+    bool sharesStructureWith(const PersistentRedBlackTree<T> &treeParameter) const;
+    template <class Tjwme>
+    friend const PersistentNodeT<Tjwme> *getTreeRoot(const PersistentRedBlackTree<Tjwme> &rbt);
+};
+
+// Constructor
+template <class T>
+PersistentRedBlackTree<T>::PersistentRedBlackTree() : treeSize(0)
+{
+}
+
+// Inserts the value parameter into the tree
+// Returns true on success or false if the value is already present
+template <class T>
+bool PersistentRedBlackTree<T>::insert(const T valueToStore)
+{
+    if (Ops::find(root.get(), valueToStore) != nullptr)
+    {
+        return false;
+    }
+    root = Ops::insert(root, valueToStore);
+    treeSize++;
+    return true;
+}
+
+// Removes the value parameter from the tree
+// Returns true on success or false if the value is not present
+template <class T>
+bool PersistentRedBlackTree<T>::remove(const T valueToRemove)
+{
+    if (Ops::find(root.get(), valueToRemove) == nullptr)
+    {
+        return false;
+    }
+    root = Ops::remove(root, valueToRemove);
+    treeSize--;
+    return true;
+}
+
+// Searches the tree for the provided parameter
+// Returns true if found, false otherwise
+template <class T>
+bool PersistentRedBlackTree<T>::search(const T valueToSearch) const
+{
+    return Ops::find(root.get(), valueToSearch) != nullptr;
+}
+
+// Returns a vector containing values between the method's first and second parameters
+// The vector is in ascending order
+template <class T>
+vector<T> PersistentRedBlackTree<T>::search(const T valueToSearch1, const T valueToSearch2) const
+{
+    vector<T> treeValuesInRange;
+    if (valueToSearch1 > valueToSearch2)
+    {
+        Ops::rangeSearch(root.get(), valueToSearch2, valueToSearch1, treeValuesInRange);
+    }
+    else
+    {
+        Ops::rangeSearch(root.get(), valueToSearch1, valueToSearch2, treeValuesInRange);
+    }
+    return treeValuesInRange;
+}
+
+// Returns the largest value in the tree that is less than the parameter
+// Returns the parameter if there is no such value
+template <class T>
+T PersistentRedBlackTree<T>::closestLess(const T valueToCompare) const
+{
+    const PersistentNodeT<T> *closestNode = Ops::closestLess(root.get(), valueToCompare);
+    return closestNode == nullptr ? valueToCompare : closestNode->data;
+}
+
+// Returns the smallest value in the tree that is greater than the parameter
+// Returns the parameter if there is no such value
+template <class T>
+T PersistentRedBlackTree<T>::closestGreater(const T valueToCompare) const
+{
+    const PersistentNodeT<T> *closestNode = Ops::closestGreater(root.get(), valueToCompare);
+    return closestNode == nullptr ? valueToCompare : closestNode->data;
+}
+
+// Returns a vector containing all of the values in the tree in ascending order
+template <class T>
+vector<T> PersistentRedBlackTree<T>::values() const
+{
+    vector<T> treeValues;
+    treeValues.reserve(treeSize);
+    Ops::inOrderValues(root.get(), treeValues);
+    return treeValues;
+}
+
+// Returns the number of values in the tree
+template <class T>
+int PersistentRedBlackTree<T>::size() const
+{
+    return treeSize;
+}
+
+// Returns true if both trees are the same version, sharing every node
+template <class T>
+bool PersistentRedBlackTree<T>::sharesStructureWith(const PersistentRedBlackTree<T> &treeParameter) const
+{
+    return root.get() == treeParameter.root.get();
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include "StreamingStats.h"
+#include <chrono>
+#include <climits>
+#include <deque>
+#include <utility>
+
+// Statistics over a moving window of the most recent samples: the last N values, the last T of time, or both
+// Unlike StreamingStats every sample counts, repeats included, so each is stored in an order-statistic
+// RedBlackTree keyed by (value, arrival sequence number). A sample leaving the window is taken out with
+// one O(log n) remove, so adding a sample and then asking for the median, p99, closest values or the
+// spread of any value range are all O(log n) however large the window is; the mode comes from a second
+// tree ordered by how often each value occurs.
+// Timestamps passed to add and expire must never go backwards
+class SlidingWindowStats
+{
+    // Private attributes and helper methods
+private:
+    using Clock = std::chrono::steady_clock;
+    using WindowKey = std::pair<double, long long>; // (value, sequence number)
+
+    struct Sample
+    {
+        WindowKey key;
+        Clock::time_point arrival;
+    };
+
+    RedBlackTree<WindowKey> windowValues;
+    RedBlackTree<std::pair<int, double>> valueCounts; // (samples with the value, negated value); the last entry is the mode
+    std::deque<Sample> arrivalOrder; // Oldest sample at the front
+    CompensatedSum windowSum;
+    size_t maximumCount;    // 0 for no limit on the number of samples
+    Clock::duration maximumAge; // Zero for no limit on their age
+    long long nextSequence;
+    void evictOldest();
+    int samplesOf(double value) const;
+
+    // Public methods
+public:
+    explicit SlidingWindowStats(size_t maximumCount);
+    explicit SlidingWindowStats(Clock::duration maximumAge);
+    SlidingWindowStats(size_t maximumCount, Clock::duration maximumAge);
+    void add(double value);
+    void add(double value, Clock::time_point arrival);
+    void expire(Clock::time_point now);
+    int count() const;
+    double sum() const;
+    double mean() const;
+    double median() const;
+    double variance() const;
+    double standardDeviation() const;
+    ValueSummary summary(double lowerValue, double higherValue) const;
+    double mode() const;
+    double quantile(double fraction) const;
+    vector<double> quantiles(const vector<double> &fractions) const;
+    double closestLess(double valueToCompare) const;
+    double closestGreater(double valueToCompare) const;
+};
+
+// Constructor for a window of the last maximumCount samples
+inline SlidingWindowStats::SlidingWindowStats(size_t maximumCount)
+    : SlidingWindowStats(maximumCount, Clock::duration::zero())
+{
+}
+
+// Constructor for a window of the samples that arrived within maximumAge (for example std::chrono::seconds(60))
+inline SlidingWindowStats::SlidingWindowStats(Clock::duration maximumAge)
+    : SlidingWindowStats(0, maximumAge)
+{
+}
+
+// Constructor for a window limited both in samples and in age; a zero limit is no limit
+inline SlidingWindowStats::SlidingWindowStats(size_t maximumCount, Clock::duration maximumAge)
+    : maximumCount(maximumCount), maximumAge(maximumAge), nextSequence(0)
+{
+}
+
+// Takes the oldest sample out of the window
+inline void SlidingWindowStats::evictOldest()
+{
+    const Sample &oldest = arrivalOrder.front();
+    double value = oldest.key.first;
+    int valueSamples = samplesOf(value);
+    valueCounts.remove(std::make_pair(valueSamples, -value));
+    if (valueSamples > 1)
+    {
+        valueCounts.insert(std::make_pair(valueSamples - 1, -value));
+    }
+    windowValues.remove(oldest.key);
+    windowSum.add(-oldest.key.first);
+    arrivalOrder.pop_front();
+}
+
+// Returns the number of samples in the window equal to the value
+inline int SlidingWindowStats::samplesOf(double value) const
+{
+    return windowValues.rank(WindowKey(value, LLONG_MAX)) - windowValues.rank(WindowKey(value, LLONG_MIN));
+}
+
+// Adds a sample arriving now
+inline void SlidingWindowStats::add(double value)
+{
+    add(value, Clock::now());
+}
+
+// Adds a sample that arrived at the given time, first dropping any samples that have left the window
+inline void SlidingWindowStats::add(double value, Clock::time_point arrival)
+{
+    expire(arrival);
+    WindowKey key(value, nextSequence++);
+    windowValues.insert(key);
+    windowSum.add(value);
+    int valueSamples = samplesOf(value);
+    if (valueSamples > 1)
+    {
+        valueCounts.remove(std::make_pair(valueSamples - 1, -value));
+    }
+    valueCounts.insert(std::make_pair(valueSamples, -value));
+    arrivalOrder.push_back(Sample{key, arrival});
+    if (maximumCount != 0 && arrivalOrder.size() > maximumCount)
+    {
+        evictOldest();
+    }
+}
+
+// Drops the samples that are older than the maximum age at the given time
+// Call it before reading the statistics when no sample has arrived for a while
+inline void SlidingWindowStats::expire(Clock::time_point now)
+{
+    if (maximumAge == Clock::duration::zero())
+    {
+        return;
+    }
+    while (!arrivalOrder.empty() && now - arrivalOrder.front().arrival > maximumAge)
+    {
+        evictOldest();
+    }
+}
+
+// Returns the number of samples in the window
+inline int SlidingWindowStats::count() const
+{
+    return windowValues.size();
+}
+
+// Returns the sum of the samples in the window
+inline double SlidingWindowStats::sum() const
+{
+    return windowSum.value();
+}
+
+// Returns the average of the samples in the window, or 0 if it is empty
+inline double SlidingWindowStats::mean() const
+{
+    return count() == 0 ? 0.0 : sum() / count();
+}
+
+// Returns the median of the samples in the window, or 0 if it is empty
+// With an even count it is the average of the two central samples
+inline double SlidingWindowStats::median() const
+{
+    int numOfValues = count();
+    if (numOfValues == 0)
+    {
+        return 0.0;
+    }
+    if (numOfValues % 2 != 0)
+    {
+        return windowValues.select(numOfValues / 2).first;
+    }
+    return (windowValues.select((numOfValues - 1) / 2).first + windowValues.select(numOfValues / 2).first) / 2.0;
+}
+
+// Returns the population variance of the samples in the window in O(1), or 0 if it is empty
+inline double SlidingWindowStats::variance() const
+{
+    return windowValues.summary().variance();
+}
+
+// Returns the population standard deviation of the samples in the window in O(1), or 0 if it is empty
+inline double SlidingWindowStats::standardDeviation() const
+{
+    return windowValues.summary().standardDeviation();
+}
+
+// Returns the count, sum, mean and spread of the samples between the two values, both included, in O(log n)
+inline ValueSummary SlidingWindowStats::summary(double lowerValue, double higherValue) const
+{
+    if (lowerValue > higherValue)
+    {
+        std::swap(lowerValue, higherValue);
+    }
+    return windowValues.summary(WindowKey(lowerValue, LLONG_MIN), WindowKey(higherValue, LLONG_MAX));
+}
+
+// Returns the most frequent value in the window (the smallest of them on a tie), or 0 if it is empty
+inline double SlidingWindowStats::mode() const
+{
+    return valueCounts.size() == 0 ? 0.0 : -valueCounts.select(valueCounts.size() - 1).second;
+}
+
+// Returns the given quantile of the samples in the window (0.99 for p99), or 0 if it is empty
+// Quantiles that fall between two samples are interpolated linearly between them
+inline double SlidingWindowStats::quantile(double fraction) const
+{
+    return quantiles(vector<double>{fraction}).front();
+}
+
+// Returns the given quantiles, such as {0.5, 0.9, 0.99, 0.999}, in the same order
+inline vector<double> SlidingWindowStats::quantiles(const vector<double> &fractions) const
+{
+    return ::quantiles(windowValues, fractions, [](const WindowKey &key)
+                       { return key.first; });
+}
+
+// Returns the largest sample in the window that is less than the parameter, or the parameter if there is none
+inline double SlidingWindowStats::closestLess(double valueToCompare) const
+{
+    // Every sample equal to the parameter sorts after (valueToCompare, LLONG_MIN)
+    WindowKey bound(valueToCompare, LLONG_MIN);
+    WindowKey closestKey = windowValues.closestLess(bound);
+    return closestKey == bound ? valueToCompare : closestKey.first;
+}
+
+// Returns the smallest sample in the window that is greater than the parameter, or the parameter if there is none
+inline double SlidingWindowStats::closestGreater(double valueToCompare) const
+{
+    // Every sample equal to the parameter sorts before (valueToCompare, LLONG_MAX)
+    WindowKey bound(valueToCompare, LLONG_MAX);
+    WindowKey closestKey = windowValues.closestGreater(bound);
+    return closestKey == bound ? valueToCompare : closestKey.first;
+}
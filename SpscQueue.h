@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread
+// Only the producer writes tail and only the consumer writes head, so neither side ever takes a lock;
+// the two indices sit on separate cache lines so pushing and popping do not keep stealing each other's line
+template <class T>
+class SpscQueue
+{
+    // Private attributes
+private:
+    std::unique_ptr<T[]> slots;
+    size_t capacity;
+    alignas(64) std::atomic<size_t> head{0}; // Count of values popped so far
+    alignas(64) std::atomic<size_t> tail{0}; // Count of values pushed so far
+
+    // Public methods
+public:
+    explicit SpscQueue(size_t capacity);
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+    bool tryPush(T &value);
+    bool tryPop(T &value);
+    void push(T value);
+    T pop();
+};
+
+// Constructor
+// The queue holds at most capacity values (at least one)
+template <class T>
+SpscQueue<T>::SpscQueue(size_t capacity) : capacity(capacity == 0 ? 1 : capacity)
+{
+    slots.reset(new T[this->capacity]);
+}
+
+// Moves the value into the queue
+// Returns true on success or false, leaving the value untouched, if the queue is full
+// Only the producer thread may call it
+template <class T>
+bool SpscQueue<T>::tryPush(T &value)
+{
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail - head.load(std::memory_order_acquire) == capacity)
+    {
+        return false;
+    }
+    slots[currentTail % capacity] = std::move(value);
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+}
+
+// Moves the oldest value out of the queue into the parameter
+// Returns true on success or false if the queue is empty
+// Only the consumer thread may call it
+template <class T>
+bool SpscQueue<T>::tryPop(T &value)
+{
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    value = std::move(slots[currentHead % capacity]);
+    head.store(currentHead + 1, std::memory_order_release);
+    return true;
+}
+
+// Moves the value into the queue, yielding while the queue is full
+template <class T>
+void SpscQueue<T>::push(T value)
+{
+    while (!tryPush(value))
+    {
+        std::this_thread::yield();
+    }
+}
+
+// Removes and returns the oldest value, yielding while the queue is empty
+template <class T>
+T SpscQueue<T>::pop()
+{
+    T value;
+    while (!tryPop(value))
+    {
+        std::this_thread::yield();
+    }
+    return value;
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include "RedBlackTree.h"
+#include <cmath>
+
+// Running sum that keeps the low-order bits each addition rounds away (Neumaier summation),
+// so long streams of additions and removals stay accurate
+class CompensatedSum
+{
+    // Private attributes
+private:
+    double runningSum;
+    double compensation;
+
+    // Public methods
+public:
+    CompensatedSum();
+    void add(double value);
+    double value() const;
+};
+
+// Constructor
+inline CompensatedSum::CompensatedSum() : runningSum(0.0), compensation(0.0)
+{
+}
+
+// Adds the value (or removes it, when given its negation)
+inline void CompensatedSum::add(double value)
+{
+    double newSum = runningSum + value;
+    if (std::fabs(runningSum) >= std::fabs(value))
+    {
+        compensation += (runningSum - newSum) + value;
+    }
+    else
+    {
+        compensation += (value - newSum) + runningSum;
+    }
+    runningSum = newSum;
+}
+
+// Returns the sum
+inline double CompensatedSum::value() const
+{
+    return runningSum + compensation;
+}
+
+// Running statistics over the unique values of a stream, answerable at any point mid-stream
+// Values go into an order-statistic RedBlackTree<double>, so adding or removing one and asking for
+// the median or any quantile each take O(log n); the sum is kept alongside and never re-scanned.
+// As in statistics(), a value seen more than once only counts once
+class StreamingStats
+{
+    // Private attributes and helper methods
+private:
+    RedBlackTree<double> uniqueValues;
+    CompensatedSum uniqueSum;
+
+    // Public methods
+public:
+    StreamingStats();
+    bool add(double value);
+    bool remove(double value);
+    int count() const;
+    double sum() const;
+    double mean() const;
+    double median() const;
+    double variance() const;
+    double standardDeviation() const;
+    double quantile(double fraction) const;
+    vector<double> quantiles(const vector<double> &fractions) const;
+    double closestLess(double valueToCompare) const;
+    double closestGreater(double valueToCompare) const;
+    const RedBlackTree<double> &values() const;
+};
+
+// Constructor
+inline StreamingStats::StreamingStats()
+{
+}
+
+// Adds a value from the stream
+// Returns true if it is new, false if it has been seen before (and so changes nothing)
+inline bool StreamingStats::add(double value)
+{
+    if (!uniqueValues.insert(value))
+    {
+        return false;
+    }
+    uniqueSum.add(value);
+    return true;
+}
+
+// Takes a value back out, for instance when it leaves a window
+// Returns true on success or false if the value is not present
+inline bool StreamingStats::remove(double value)
+{
+    if (!uniqueValues.remove(value))
+    {
+        return false;
+    }
+    uniqueSum.add(-value);
+    return true;
+}
+
+// Returns the number of unique values
+inline int StreamingStats::count() const
+{
+    return uniqueValues.size();
+}
+
+// Returns the sum of the unique values
+inline double StreamingStats::sum() const
+{
+    return uniqueSum.value();
+}
+
+// Returns the average of the unique values, or 0 if there are none
+inline double StreamingStats::mean() const
+{
+    return count() == 0 ? 0.0 : sum() / count();
+}
+
+// Returns the median of the unique values, or 0 if there are none
+// With an even count it is the average of the two central values
+inline double StreamingStats::median() const
+{
+    int numOfValues = count();
+    if (numOfValues == 0)
+    {
+        return 0.0;
+    }
+    if (numOfValues % 2 != 0)
+    {
+        return uniqueValues.select(numOfValues / 2);
+    }
+    return (uniqueValues.select((numOfValues - 1) / 2) + uniqueValues.select(numOfValues / 2)) / 2.0;
+}
+
+// Returns the population variance of the unique values in O(1), or 0 if there are none
+inline double StreamingStats::variance() const
+{
+    return uniqueValues.summary().variance();
+}
+
+// Returns the population standard deviation of the unique values in O(1), or 0 if there are none
+inline double StreamingStats::standardDeviation() const
+{
+    return uniqueValues.summary().standardDeviation();
+}
+
+// Returns the given quantile (0 is the minimum, 0.5 the median, 1 the maximum), or 0 if there are no values
+// Quantiles that fall between two values are interpolated linearly between them
+inline double StreamingStats::quantile(double fraction) const
+{
+    return ::quantiles(uniqueValues, vector<double>{fraction}).front();
+}
+
+// Returns the given quantiles, such as {0.5, 0.9, 0.99, 0.999}, in the same order
+inline vector<double> StreamingStats::quantiles(const vector<double> &fractions) const
+{
+    return ::quantiles(uniqueValues, fractions);
+}
+
+// Returns the largest value less than the parameter, or the parameter if there is none
+inline double StreamingStats::closestLess(double valueToCompare) const
+{
+    return uniqueValues.closestLess(valueToCompare);
+}
+
+// Returns the smallest value greater than the parameter, or the parameter if there is none
+inline double StreamingStats::closestGreater(double valueToCompare) const
+{
+    return uniqueValues.closestGreater(valueToCompare);
+}
+
+// Returns the tree of unique values seen so far
+inline const RedBlackTree<double> &StreamingStats::values() const
+{
+    return uniqueValues;
+}
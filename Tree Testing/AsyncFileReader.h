@@ -0,0 +1,415 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define ASYNC_FILE_READER_IO_URING
+#endif
+#endif
+using std::string;
+using std::vector;
+
+// Reads a file from front to back in fixed-size blocks, keeping several block reads in flight
+// On Linux the reads are queued with io_uring, up to queueDepth at a time, so the device always has
+// requests waiting while the caller works on the blocks that have already arrived. Blocks are handed
+// to the caller in file order. Where io_uring is unavailable (older kernels, seccomp sandboxes, other
+// platforms), a queued read comes back short or the ring stops accepting calls part way through,
+// blocks are read with pread instead. Pipes, terminals and other files without a size are read
+// one block at a time with read, so memory stays at one block however much they deliver
+class AsyncFileReader
+{
+    // Private attributes and helper methods
+private:
+    size_t blockSize;
+    int queueDepth;
+    bool ioUringAllowed;
+    bool ioUringUsed;
+
+#ifdef ASYNC_FILE_READER_IO_URING
+    // The submission and completion rings shared with the kernel
+    struct IoUring
+    {
+        int ringDescriptor = -1;
+        void *submissionRing = MAP_FAILED;
+        size_t submissionRingSize = 0;
+        void *completionRing = MAP_FAILED;
+        size_t completionRingSize = 0;
+        io_uring_sqe *submissionEntries = static_cast<io_uring_sqe *>(MAP_FAILED);
+        size_t submissionEntriesSize = 0;
+        unsigned *submissionTail = nullptr;
+        unsigned *submissionMask = nullptr;
+        unsigned *submissionArray = nullptr;
+        unsigned *completionHead = nullptr;
+        unsigned *completionTail = nullptr;
+        unsigned *completionMask = nullptr;
+        io_uring_cqe *completionEntries = nullptr;
+        unsigned queued = 0; // Reads added to the submission ring but not yet submitted
+
+        bool setUp(unsigned entries);
+        ~IoUring();
+        void queueRead(int fileDescriptor, char *buffer, size_t length, size_t offset, unsigned long long tag);
+        bool submitAndWait(unsigned completions);
+        template <class Handler>
+        void reapCompletions(Handler handleCompletion);
+    };
+#endif
+
+    static bool readBlock(int fileDescriptor, char *buffer, size_t length, size_t offset);
+
+    // Public methods
+public:
+    explicit AsyncFileReader(size_t blockSize = 1 << 20, int queueDepth = 8, bool ioUringAllowed = true);
+    template <class Consumer>
+    bool read(const string &filename, Consumer consumeBlock);
+    bool usedIoUring() const;
+};
+
+// Constructor
+// Blocks are blockSize bytes (the last one may be shorter) with up to queueDepth of them read ahead;
+// passing false for ioUringAllowed always uses pread
+inline AsyncFileReader::AsyncFileReader(size_t blockSize, int queueDepth, bool ioUringAllowed)
+    : blockSize(std::max<size_t>(blockSize, 1)), queueDepth(std::max(queueDepth, 1)), ioUringAllowed(ioUringAllowed), ioUringUsed(false)
+{
+}
+
+// Returns true if the last call to read used io_uring
+inline bool AsyncFileReader::usedIoUring() const
+{
+    return ioUringUsed;
+}
+
+// Reads length bytes at offset into the buffer with blocking reads
+// Returns false if the file ends early or a read fails
+inline bool AsyncFileReader::readBlock(int fileDescriptor, char *buffer, size_t length, size_t offset)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    while (length > 0)
+    {
+        ssize_t bytesRead = pread(fileDescriptor, buffer, length, offset);
+        if (bytesRead <= 0)
+        {
+            return false;
+        }
+        buffer += bytesRead;
+        length -= bytesRead;
+        offset += bytesRead;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Reads the whole file and calls consumeBlock(first, last) for each block in order
+// consumeBlock returns false to stop reading early; the bytes it is given are only valid during the call
+// Returns false if the file cannot be opened or read
+template <class Consumer>
+bool AsyncFileReader::read(const string &filename, Consumer consumeBlock)
+{
+    ioUringUsed = false;
+#if defined(__unix__) || defined(__APPLE__)
+    int fileDescriptor = open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor == -1)
+    {
+        return false;
+    }
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0)
+    {
+        close(fileDescriptor);
+        return false;
+    }
+    if (!S_ISREG(fileStatus.st_mode))
+    {
+        // There is no size to split into blocks, so take whatever each read delivers until the stream ends
+        vector<char> buffer(blockSize);
+        bool succeeded = true;
+        while (true)
+        {
+            ssize_t bytesRead = ::read(fileDescriptor, buffer.data(), blockSize);
+            if (bytesRead < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (bytesRead < 0)
+            {
+                succeeded = false;
+                break;
+            }
+            if (bytesRead == 0 || !consumeBlock((const char *)buffer.data(), (const char *)buffer.data() + bytesRead))
+            {
+                break;
+            }
+        }
+        close(fileDescriptor);
+        return succeeded;
+    }
+    size_t fileSize = fileStatus.st_size;
+    size_t blockCount = (fileSize + blockSize - 1) / blockSize;
+    size_t slotCount = std::min<size_t>(queueDepth, std::max<size_t>(blockCount, 1));
+    vector<char> buffers(slotCount * blockSize);
+    bool succeeded = true;
+
+#ifdef ASYNC_FILE_READER_IO_URING
+    IoUring ring;
+    if (ioUringAllowed && blockCount > 0 && ring.setUp(slotCount))
+    {
+        ioUringUsed = true;
+
+        // Block b is read into slot b % slotCount; each slot's result is -1 until its read completes
+        vector<long long> slotResults(slotCount, -1);
+        size_t inFlight = 0; // Reads queued or submitted that have not completed
+        bool ringWorks = true;
+        auto blockLength = [&](size_t block)
+        {
+            return std::min(blockSize, fileSize - block * blockSize);
+        };
+        for (size_t block = 0; block < slotCount; block++)
+        {
+            ring.queueRead(fileDescriptor, &buffers[block * blockSize], blockLength(block), block * blockSize, block);
+            inFlight++;
+        }
+        auto recordCompletion = [&](unsigned long long slot, int result)
+        {
+            slotResults[slot] = std::max(result, 0);
+            inFlight--;
+        };
+
+        // Waits until every read the kernel has accepted is complete, so none can still write into a buffer
+        // If io_uring_enter stops working, the completion ring is polled instead: the kernel keeps posting
+        // to it without being entered, and reads that were only queued are never started
+        auto finishSubmittedReads = [&]()
+        {
+            while (inFlight > ring.queued)
+            {
+                if (ringWorks && !ring.submitAndWait(1))
+                {
+                    ringWorks = false;
+                }
+                if (!ringWorks)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+                ring.reapCompletions(recordCompletion);
+            }
+        };
+
+        for (size_t block = 0; block < blockCount; block++)
+        {
+            size_t slot = block % slotCount;
+            while (ringWorks && slotResults[slot] < 0)
+            {
+                if (!ring.submitAndWait(1))
+                {
+                    // Stop using the ring; the remaining blocks are read with pread
+                    ringWorks = false;
+                    finishSubmittedReads();
+                    break;
+                }
+                ring.reapCompletions(recordCompletion);
+            }
+
+            // Finish a short, failed or never started read with pread
+            char *blockStart = &buffers[slot * blockSize];
+            size_t length = blockLength(block);
+            size_t received = std::max<long long>(slotResults[slot], 0);
+            if (received < length && !readBlock(fileDescriptor, blockStart + received, length - received, block * blockSize + received))
+            {
+                succeeded = false;
+                break;
+            }
+            if (!consumeBlock((const char *)blockStart, (const char *)blockStart + length))
+            {
+                break;
+            }
+
+            // Reuse the slot for the block slotCount further on
+            slotResults[slot] = -1;
+            size_t nextBlock = block + slotCount;
+            if (ringWorks && nextBlock < blockCount)
+            {
+                ring.queueRead(fileDescriptor, blockStart, blockLength(nextBlock), nextBlock * blockSize, slot);
+                inFlight++;
+            }
+        }
+
+        // The kernel may still be writing into the buffers, so wait for every read before releasing them
+        finishSubmittedReads();
+        close(fileDescriptor);
+        return succeeded;
+    }
+#endif
+
+    for (size_t block = 0; block < blockCount; block++)
+    {
+        size_t length = std::min(blockSize, fileSize - block * blockSize);
+        if (!readBlock(fileDescriptor, buffers.data(), length, block * blockSize))
+        {
+            succeeded = false;
+            break;
+        }
+        if (!consumeBlock((const char *)buffers.data(), (const char *)buffers.data() + length))
+        {
+            break;
+        }
+    }
+    close(fileDescriptor);
+    return succeeded;
+#else
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    vector<char> buffer(blockSize);
+    while (file.read(buffer.data(), blockSize) || file.gcount() > 0)
+    {
+        if (!consumeBlock((const char *)buffer.data(), (const char *)buffer.data() + file.gcount()))
+        {
+            break;
+        }
+    }
+    return true;
+#endif
+}
+
+#ifdef ASYNC_FILE_READER_IO_URING
+// Creates the rings with room for the given number of reads and maps them into this process
+// Returns false if io_uring is not available
+inline bool AsyncFileReader::IoUring::setUp(unsigned entries)
+{
+    io_uring_params parameters;
+    std::memset(&parameters, 0, sizeof(parameters));
+    ringDescriptor = syscall(__NR_io_uring_setup, entries, &parameters);
+    if (ringDescriptor < 0)
+    {
+        return false;
+    }
+
+    submissionRingSize = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+    completionRingSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+    bool singleMapping = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMapping)
+    {
+        submissionRingSize = completionRingSize = std::max(submissionRingSize, completionRingSize);
+    }
+    submissionRing = mmap(nullptr, submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_SQ_RING);
+    if (submissionRing == MAP_FAILED)
+    {
+        return false;
+    }
+    if (!singleMapping)
+    {
+        completionRing = mmap(nullptr, completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_CQ_RING);
+        if (completionRing == MAP_FAILED)
+        {
+            return false;
+        }
+    }
+    submissionEntriesSize = parameters.sq_entries * sizeof(io_uring_sqe);
+    submissionEntries = static_cast<io_uring_sqe *>(mmap(nullptr, submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_SQES));
+    if (submissionEntries == MAP_FAILED)
+    {
+        return false;
+    }
+
+    char *submissionBase = static_cast<char *>(submissionRing);
+    char *completionBase = static_cast<char *>(singleMapping ? submissionRing : completionRing);
+    submissionTail = reinterpret_cast<unsigned *>(submissionBase + parameters.sq_off.tail);
+    submissionMask = reinterpret_cast<unsigned *>(submissionBase + parameters.sq_off.ring_mask);
+    submissionArray = reinterpret_cast<unsigned *>(submissionBase + parameters.sq_off.array);
+    completionHead = reinterpret_cast<unsigned *>(completionBase + parameters.cq_off.head);
+    completionTail = reinterpret_cast<unsigned *>(completionBase + parameters.cq_off.tail);
+    completionMask = reinterpret_cast<unsigned *>(completionBase + parameters.cq_off.ring_mask);
+    completionEntries = reinterpret_cast<io_uring_cqe *>(completionBase + parameters.cq_off.cqes);
+    return true;
+}
+
+// Destructor
+inline AsyncFileReader::IoUring::~IoUring()
+{
+    if (submissionEntries != MAP_FAILED)
+    {
+        munmap(submissionEntries, submissionEntriesSize);
+    }
+    if (completionRing != MAP_FAILED)
+    {
+        munmap(completionRing, completionRingSize);
+    }
+    if (submissionRing != MAP_FAILED)
+    {
+        munmap(submissionRing, submissionRingSize);
+    }
+    if (ringDescriptor >= 0)
+    {
+        close(ringDescriptor);
+    }
+}
+
+// Adds a read to the submission ring; the kernel sees it at the next submitAndWait
+// Never queues more reads than the ring was set up for
+inline void AsyncFileReader::IoUring::queueRead(int fileDescriptor, char *buffer, size_t length, size_t offset, unsigned long long tag)
+{
+    unsigned tail = *submissionTail;
+    unsigned index = tail & *submissionMask;
+    io_uring_sqe &entry = submissionEntries[index];
+    std::memset(&entry, 0, sizeof(entry));
+    entry.opcode = IORING_OP_READ;
+    entry.fd = fileDescriptor;
+    entry.addr = reinterpret_cast<unsigned long long>(buffer);
+    entry.len = length;
+    entry.off = offset;
+    entry.user_data = tag;
+    submissionArray[index] = index;
+    __atomic_store_n(submissionTail, tail + 1, __ATOMIC_RELEASE);
+    queued++;
+}
+
+// Submits the queued reads and waits until at least the given number of reads have completed
+// Returns false if the kernel rejects the call
+inline bool AsyncFileReader::IoUring::submitAndWait(unsigned completions)
+{
+    while (true)
+    {
+        int submitted = syscall(__NR_io_uring_enter, ringDescriptor, queued, completions, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (submitted >= 0)
+        {
+            queued -= submitted;
+            return true;
+        }
+        if (errno != EINTR)
+        {
+            return false;
+        }
+    }
+}
+
+// Calls handleCompletion(tag, result) for every completed read; result is the byte count or a negative errno
+template <class Handler>
+void AsyncFileReader::IoUring::reapCompletions(Handler handleCompletion)
+{
+    unsigned head = *completionHead;
+    unsigned tail = __atomic_load_n(completionTail, __ATOMIC_ACQUIRE);
+    while (head != tail)
+    {
+        const io_uring_cqe &entry = completionEntries[head & *completionMask];
+        handleCompletion(entry.user_data, entry.res);
+        head++;
+    }
+    __atomic_store_n(completionHead, head, __ATOMIC_RELEASE);
+}
+#endif
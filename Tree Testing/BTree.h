@@ -0,0 +1,629 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+using std::vector;
+
+// BTreeNode class
+// Stores up to NodeCapacity sorted keys and NodeCapacity + 1 children in one block,
+// so a single cache-friendly node replaces several levels of a binary tree
+template <class T, int NodeCapacity>
+class BTreeNode
+{
+public:
+    int keyCount;
+    bool isLeaf;
+    T keys[NodeCapacity];
+    BTreeNode<T, NodeCapacity> *children[NodeCapacity + 1];
+
+    // BTreeNode Constructor
+    BTreeNode(bool leaf) : keyCount(0), isLeaf(leaf)
+    {
+        for (int i = 0; i <= NodeCapacity; i++)
+        {
+            children[i] = nullptr;
+        }
+    };
+};
+
+// B-tree engine with the same public interface as RedBlackTree
+// Code written against RedBlackTree<T> can switch engines by changing a template argument
+template <class T, int NodeCapacity = 32>
+class BTree
+{
+    static_assert(NodeCapacity >= 16 && NodeCapacity <= 64, "BTree nodes must hold between 16 and 64 keys");
+
+    // Private attributes and helper methods
+private:
+    // Every node other than the root holds at least minKeys keys
+    static const int minKeys = (NodeCapacity - 1) / 2;
+
+    BTreeNode<T, NodeCapacity> *root;
+    int treeSize;
+    BTreeNode<T, NodeCapacity> *copyTree(const BTreeNode<T, NodeCapacity> *treeNode);
+    void deleteTree(BTreeNode<T, NodeCapacity> *treeNode);
+    int lowerBound(const BTreeNode<T, NodeCapacity> *currentNode, const T valueToSearch) const;
+    void splitChild(BTreeNode<T, NodeCapacity> *parentNode, int childIndex);
+    void insertNonFull(BTreeNode<T, NodeCapacity> *currentNode, const T valueToStore);
+    void removeFromNode(BTreeNode<T, NodeCapacity> *currentNode, const T valueToRemove);
+    void fillChild(BTreeNode<T, NodeCapacity> *parentNode, int childIndex);
+    void borrowFromPrevious(BTreeNode<T, NodeCapacity> *parentNode, int childIndex);
+    void borrowFromNext(BTreeNode<T, NodeCapacity> *parentNode, int childIndex);
+    void mergeChildren(BTreeNode<T, NodeCapacity> *parentNode, int childIndex);
+    void inOrderValues(const BTreeNode<T, NodeCapacity> *currentNode, vector<T> &treeValues) const;
+    void rangeSearch(const BTreeNode<T, NodeCapacity> *currentNode, const T valueToSearch1,
+                     const T valueToSearch2, vector<T> &treeValues) const;
+
+    // Public methods
+public:
+    BTree();
+    BTree(const BTree<T, NodeCapacity> &treeParameter);
+    BTree<T, NodeCapacity> &operator=(const BTree<T, NodeCapacity> &treeParameter);
+    ~BTree();
+    bool insert(const T valueToStore);
+    bool remove(const T valueToRemove);
+    bool search(const T valueToSearch) const;
+    vector<T> search(const T valueToSearch1, const T valueToSearch2) const;
+    T closestLess(const T valueToCompare) const;
+    T closestGreater(const T valueToCompare) const;
+    vector<T> values() const;
+    int size() const;
+};
+
+// Constructor
+template <class T, int NodeCapacity>
+BTree<T, NodeCapacity>::BTree()
+{
+    // Create an empty tree
+    root = nullptr;
+    treeSize = 0;
+}
+
+// Copy constructor
+template <class T, int NodeCapacity>
+BTree<T, NodeCapacity>::BTree(const BTree<T, NodeCapacity> &treeParameter)
+{
+    // Deep copies its constant BTree reference parameter
+    root = copyTree(treeParameter.root);
+    treeSize = treeParameter.treeSize;
+}
+
+// Overloads the assignment operator for BTree
+template <class T, int NodeCapacity>
+BTree<T, NodeCapacity> &BTree<T, NodeCapacity>::operator=(const BTree<T, NodeCapacity> &treeParameter)
+{
+    // If the calling object is the parameter, the operator should not copy it
+    if (this != &treeParameter)
+    {
+        // Deallocates dynamic memory associated with the original tree
+        deleteTree(root);
+        root = nullptr;
+
+        root = copyTree(treeParameter.root);
+        treeSize = treeParameter.treeSize;
+    }
+    // Returns a reference to the calling object
+    return *this;
+}
+
+// Destructor
+template <class T, int NodeCapacity>
+BTree<T, NodeCapacity>::~BTree()
+{
+    deleteTree(root);
+    root = nullptr;
+    treeSize = 0;
+}
+
+// Helper function to create a copy of the parameter
+// onto the calling object tree
+template <class T, int NodeCapacity>
+BTreeNode<T, NodeCapacity> *BTree<T, NodeCapacity>::copyTree(const BTreeNode<T, NodeCapacity> *treeNode)
+{
+    if (treeNode == nullptr)
+    {
+        return nullptr;
+    }
+
+    BTreeNode<T, NodeCapacity> *newNode = new BTreeNode<T, NodeCapacity>(treeNode->isLeaf);
+    newNode->keyCount = treeNode->keyCount;
+    for (int i = 0; i < treeNode->keyCount; i++)
+    {
+        newNode->keys[i] = treeNode->keys[i];
+    }
+
+    // Copy every child subtree
+    if (!treeNode->isLeaf)
+    {
+        for (int i = 0; i <= treeNode->keyCount; i++)
+        {
+            newNode->children[i] = copyTree(treeNode->children[i]);
+        }
+    }
+    return newNode;
+}
+
+// Helper Function for Destroying tree
+// Deallocates dynamic memory allocated by the tree
+template <class T, int NodeCapacity>
+void BTree<T, NodeCapacity>::deleteTree(BTreeNode<T, NodeCapacity> *treeNode)
+{
+    if (treeNode != nullptr)
+    {
+        if (!treeNode->isLeaf)
+        {
+            for (int i = 0; i <= treeNode->keyCount; i++)
+            {
+                deleteTree(treeNode->children[i]);
+            }
+        }
+        delete treeNode;
+    }
+}
+
+// Returns the index of the first key in the node that is not less than the parameter
+template <class T, int NodeCapacity>
+int BTree<T, NodeCapacity>::lowerBound(const BTreeNode<T, NodeCapacity> *currentNode, const T valueToSearch) const
+{
+    // Keys are contiguous, so a binary search only touches a few cache lines
+    return std::lower_bound(currentNode->keys, currentNode->keys + currentNode->keyCount, valueToSearch) - currentNode->keys;
+}
+
+// Inserts the value parameter into the B-tree
+// Returns true on success or false if the value is already present
+template <class T, int NodeCapacity>
+bool BTree<T, NodeCapacity>::insert(const T valueToStore)
+{
+    // If the value is already in the tree, return false
+    if (search(valueToStore))
+    {
+        return false;
+    }
+
+    if (root == nullptr)
+    {
+        root = new BTreeNode<T, NodeCapacity>(true);
+    }
+
+    // A full root is split first, which is the only way the tree grows in height
+    if (root->keyCount == NodeCapacity)
+    {
+        BTreeNode<T, NodeCapacity> *newRoot = new BTreeNode<T, NodeCapacity>(false);
+        newRoot->children[0] = root;
+        root = newRoot;
+        splitChild(root, 0);
+    }
+
+    insertNonFull(root, valueToStore);
+    treeSize++;
+    return true;
+}
+
+// Splits the full child at childIndex around its middle key,
+// moving the middle key up into the parent
+template <class T, int NodeCapacity>
+void BTree<T, NodeCapacity>::splitChild(BTreeNode<T, NodeCapacity> *parentNode, int childIndex)
+{
+    BTreeNode<T, NodeCapacity> *fullNode = parentNode->children[childIndex];
+    BTreeNode<T, NodeCapacity> *newNode = new BTreeNode<T, NodeCapacity>(fullNode->isLeaf);
+    int middleIndex = NodeCapacity / 2;
+
+    // The keys and children after the middle key move into the new right node
+    newNode->keyCount = NodeCapacity - middleIndex - 1;
+    for (int i = 0; i < newNode->keyCount; i++)
+    {
+        newNode->keys[i] = fullNode->keys[middleIndex + 1 + i];
+    }
+    if (!fullNode->isLeaf)
+    {
+        for (int i = 0; i <= newNode->keyCount; i++)
+        {
+            newNode->children[i] = fullNode->children[middleIndex + 1 + i];
+            fullNode->children[middleIndex + 1 + i] = nullptr;
+        }
+    }
+    fullNode->keyCount = middleIndex;
+
+    // Make room in the parent for the new child and the middle key
+    for (int i = parentNode->keyCount; i > childIndex; i--)
+    {
+        parentNode->children[i + 1] = parentNode->children[i];
+    }
+    parentNode->children[childIndex + 1] = newNode;
+    for (int i = parentNode->keyCount; i > childIndex; i--)
+    {
+        parentNode->keys[i] = parentNode->keys[i - 1];
+    }
+    parentNode->keys[childIndex] = fullNode->keys[middleIndex];
+    parentNode->keyCount++;
+}
+
+// Inserts the value into a node that is known to have room for it,
+// splitting full children before descending into them
+template <class T, int NodeCapacity>
+void BTree<T, NodeCapacity>::insertNonFull(BTreeNode<T, NodeCapacity> *currentNode, const T valueToStore)
+{
+    while (!currentNode->isLeaf)
+    {
+        int childIndex = lowerBound(currentNode, valueToStore);
+        if (currentNode->children[childIndex]->keyCount == NodeCapacity)
+        {
+            splitChild(currentNode, childIndex);
+
+            // The middle key moved up, so pick the side of it the value belongs to
+            if (currentNode->keys[childIndex] < valueToStore)
+            {
+                childIndex++;
+            }
+        }
+        currentNode = currentNode->children[childIndex];
+    }
+
+    // Shift larger keys to the right and place the value in the leaf
+    int i = currentNode->keyCount;
+    while (i > 0 && valueToStore < currentNode->keys[i - 1])
+    {
+        currentNode->keys[i] = currentNode->keys[i - 1];
+        i--;
+    }
+    currentNode->keys[i] = valueToStore;
+    currentNode->keyCount++;
+}
+
+// Removes the value parameter from the B-tree
+// Returns true on success or false if the value is not present
+template <class T, int NodeCapacity>
+bool BTree<T, NodeCapacity>::remove(const T valueToRemove)
+{
+    if (!search(valueToRemove))
+    {
+        return false;
+    }
+
+    removeFromNode(root, valueToRemove);
+    treeSize--;
+
+    // The root ran out of keys, so the tree shrinks in height
+    if (root->keyCount == 0)
+    {
+        BTreeNode<T, NodeCapacity> *oldRoot = root;
+        root = root->isLeaf ? nullptr : root->children[0];
+        delete oldRoot;
+    }
+    return true;
+}
+
+// Removes the value from the subtree rooted at currentNode
+// Every node visited is guaranteed to have more than minKeys keys (except the root),
+// so the removal never has to walk back up the tree
+template <class T, int NodeCapacity>
+void BTree<T, NodeCapacity>::removeFromNode(BTreeNode<T, NodeCapacity> *currentNode, const T valueToRemove)
+{
+    int keyIndex = lowerBound(currentNode, valueToRemove);
+
+    // The value is stored in this node
+    if (keyIndex < currentNode->keyCount && currentNode->keys[keyIndex] == valueToRemove)
+    {
+        if (currentNode->isLeaf)
+        {
+            for (int i = keyIndex + 1; i < currentNode->keyCount; i++)
+            {
+                currentNode->keys[i - 1] = currentNode->keys[i];
+            }
+            currentNode->keyCount--;
+        }
+        else if (currentNode->children[keyIndex]->keyCount > minKeys)
+        {
+            // Replace the key with its predecessor and remove the predecessor instead
+            BTreeNode<T, NodeCapacity> *predecessorNode = currentNode->children[keyIndex];
+            while (!predecessorNode->isLeaf)
+            {
+                predecessorNode = predecessorNode->children[predecessorNode->keyCount];
+            }
+            T predecessorValue = predecessorNode->keys[predecessorNode->keyCount - 1];
+            currentNode->keys[keyIndex] = predecessorValue;
+            removeFromNode(currentNode->children[keyIndex], predecessorValue);
+        }
+        else if (currentNode->children[keyIndex + 1]->keyCount > minKeys)
+        {
+            // Replace the key with its successor and remove the successor instead
+            BTreeNode<T, NodeCapacity> *successorNode = currentNode->children[keyIndex + 1];
+            while (!successorNode->isLeaf)
+            {
+                successorNode = successorNode->children[0];
+            }
+            T successorValue = successorNode->keys[0];
+            currentNode->keys[keyIndex] = successorValue;
+            removeFromNode(currentNode->children[keyIndex + 1], successorValue);
+        }
+        else
+        {
+            // Both neighbouring children are minimal, so merge them around the key
+            mergeChildren(currentNode, keyIndex);
+            removeFromNode(currentNode->children[keyIndex], valueToRemove);
+        }
+    }
+    else
+    {
+        // Make sure the child we descend into can afford to lose a key
+        bool isLastChild = keyIndex == currentNode->keyCount;
+        if (currentNode->children[keyIndex]->keyCount <= minKeys)
+        {
+            fillChild(currentNode, keyIndex);
+        }
+
+        // Merging the last child moves its keys into the previous child
+        if (isLastChild && keyIndex > currentNode->keyCount)
+        {
+            removeFromNode(currentNode->children[keyIndex - 1], valueToRemove);
+        }
+        else
+        {
+            removeFromNode(currentNode->children[keyIndex], valueToRemove);
+        }
+    }
+}
+
+// Gives the child at childIndex an extra key by borrowing from or merging with a sibling
+template <class T, int NodeCapacity>
+void BTree<T, NodeCapacity>::fillChild(BTreeNode<T, NodeCapacity> *parentNode, int childIndex)
+{
+    if (childIndex != 0 && parentNode->children[childIndex - 1]->keyCount > minKeys)
+    {
+        borrowFromPrevious(parentNode, childIndex);
+    }
+    else if (childIndex != parentNode->keyCount && parentNode->children[childIndex + 1]->keyCount > minKeys)
+    {
+        borrowFromNext(parentNode, childIndex);
+    }
+    else if (childIndex != parentNode->keyCount)
+    {
+        mergeChildren(parentNode, childIndex);
+    }
+    else
+    {
+        mergeChildren(parentNode, childIndex - 1);
+    }
+}
+
+// Rotates the last key of the previous sibling through the parent into the child
+template <class T, int NodeCapacity>
+void BTree<T, NodeCapacity>::borrowFromPrevious(BTreeNode<T, NodeCapacity> *parentNode, int childIndex)
+{
+    BTreeNode<T, NodeCapacity> *childNode = parentNode->children[childIndex];
+    BTreeNode<T, NodeCapacity> *siblingNode = parentNode->children[childIndex - 1];
+
+    // Shift the child's keys and children right by one
+    for (int i = childNode->keyCount; i > 0; i--)
+    {
+        childNode->keys[i] = childNode->keys[i - 1];
+    }
+    if (!childNode->isLeaf)
+    {
+        for (int i = childNode->keyCount + 1; i > 0; i--)
+        {
+            childNode->children[i] = childNode->children[i - 1];
+        }
+        childNode->children[0] = siblingNode->children[siblingNode->keyCount];
+        siblingNode->children[siblingNode->keyCount] = nullptr;
+    }
+
+    childNode->keys[0] = parentNode->keys[childIndex - 1];
+    parentNode->keys[childIndex - 1] = siblingNode->keys[siblingNode->keyCount - 1];
+    childNode->keyCount++;
+    siblingNode->keyCount--;
+}
+
+// Rotates the first key of the next sibling through the parent into the child
+template <class T, int NodeCapacity>
+void BTree<T, NodeCapacity>::borrowFromNext(BTreeNode<T, NodeCapacity> *parentNode, int childIndex)
+{
+    BTreeNode<T, NodeCapacity> *childNode = parentNode->children[childIndex];
+    BTreeNode<T, NodeCapacity> *siblingNode = parentNode->children[childIndex + 1];
+
+    childNode->keys[childNode->keyCount] = parentNode->keys[childIndex];
+    if (!childNode->isLeaf)
+    {
+        childNode->children[childNode->keyCount + 1] = siblingNode->children[0];
+    }
+    parentNode->keys[childIndex] = siblingNode->keys[0];
+
+    // Shift the sibling's keys and children left by one
+    for (int i = 1; i < siblingNode->keyCount; i++)
+    {
+        siblingNode->keys[i - 1] = siblingNode->keys[i];
+    }
+    if (!siblingNode->isLeaf)
+    {
+        for (int i = 1; i <= siblingNode->keyCount; i++)
+        {
+            siblingNode->children[i - 1] = siblingNode->children[i];
+        }
+        siblingNode->children[siblingNode->keyCount] = nullptr;
+    }
+
+    childNode->keyCount++;
+    siblingNode->keyCount--;
+}
+
+// Merges the child at childIndex, the separating key and the next child into one node
+template <class T, int NodeCapacity>
+void BTree<T, NodeCapacity>::mergeChildren(BTreeNode<T, NodeCapacity> *parentNode, int childIndex)
+{
+    BTreeNode<T, NodeCapacity> *childNode = parentNode->children[childIndex];
+    BTreeNode<T, NodeCapacity> *siblingNode = parentNode->children[childIndex + 1];
+
+    // Pull the separating key down and append the sibling's keys and children
+    childNode->keys[childNode->keyCount] = parentNode->keys[childIndex];
+    for (int i = 0; i < siblingNode->keyCount; i++)
+    {
+        childNode->keys[childNode->keyCount + 1 + i] = siblingNode->keys[i];
+    }
+    if (!childNode->isLeaf)
+    {
+        for (int i = 0; i <= siblingNode->keyCount; i++)
+        {
+            childNode->children[childNode->keyCount + 1 + i] = siblingNode->children[i];
+        }
+    }
+    childNode->keyCount += siblingNode->keyCount + 1;
+
+    // Close the gap left in the parent
+    for (int i = childIndex + 1; i < parentNode->keyCount; i++)
+    {
+        parentNode->keys[i - 1] = parentNode->keys[i];
+    }
+    for (int i = childIndex + 2; i <= parentNode->keyCount; i++)
+    {
+        parentNode->children[i - 1] = parentNode->children[i];
+    }
+    parentNode->children[parentNode->keyCount] = nullptr;
+    parentNode->keyCount--;
+
+    delete siblingNode;
+}
+
+// Searches the tree for the provided parameter
+// Returns true if found, false otherwise
+template <class T, int NodeCapacity>
+bool BTree<T, NodeCapacity>::search(const T valueToSearch) const
+{
+    BTreeNode<T, NodeCapacity> *currentNode = root;
+    while (currentNode != nullptr)
+    {
+        int keyIndex = lowerBound(currentNode, valueToSearch);
+        if (keyIndex < currentNode->keyCount && currentNode->keys[keyIndex] == valueToSearch)
+        {
+            return true;
+        }
+        currentNode = currentNode->isLeaf ? nullptr : currentNode->children[keyIndex];
+    }
+    return false;
+}
+
+// Returns the largest value in the tree that is less than the parameter
+template <class T, int NodeCapacity>
+T BTree<T, NodeCapacity>::closestLess(const T valueToCompare) const
+{
+    T closestValue = valueToCompare;
+    BTreeNode<T, NodeCapacity> *currentNode = root;
+    while (currentNode != nullptr)
+    {
+        // Every key before the lower bound is less than the parameter
+        int keyIndex = lowerBound(currentNode, valueToCompare);
+        if (keyIndex > 0)
+        {
+            closestValue = currentNode->keys[keyIndex - 1];
+        }
+        currentNode = currentNode->isLeaf ? nullptr : currentNode->children[keyIndex];
+    }
+    return closestValue;
+}
+
+// Returns the smallest value in the tree that is greater than the parameter
+template <class T, int NodeCapacity>
+T BTree<T, NodeCapacity>::closestGreater(const T valueToCompare) const
+{
+    T closestValue = valueToCompare;
+    BTreeNode<T, NodeCapacity> *currentNode = root;
+    while (currentNode != nullptr)
+    {
+        // The first key after the upper bound is the closest greater key in this node
+        int keyIndex = std::upper_bound(currentNode->keys, currentNode->keys + currentNode->keyCount, valueToCompare) - currentNode->keys;
+        if (keyIndex < currentNode->keyCount)
+        {
+            closestValue = currentNode->keys[keyIndex];
+        }
+        currentNode = currentNode->isLeaf ? nullptr : currentNode->children[keyIndex];
+    }
+    return closestValue;
+}
+
+// Returns a vector containing all of the values in the tree
+template <class T, int NodeCapacity>
+vector<T> BTree<T, NodeCapacity>::values() const
+{
+    vector<T> treeValues;
+    treeValues.reserve(treeSize);
+    inOrderValues(root, treeValues);
+    return treeValues;
+}
+
+// Returns a vector containing values between the method's first and second parameters
+// The vector is in ascending order
+template <class T, int NodeCapacity>
+vector<T> BTree<T, NodeCapacity>::search(const T valueToSearch1, const T valueToSearch2) const
+{
+    vector<T> treeValuesInRange;
+
+    // Determine which parameter value is lower and greater (bounds)
+    T lowerValue = valueToSearch1;
+    T higherValue = valueToSearch2;
+    if (valueToSearch1 > valueToSearch2)
+    {
+        lowerValue = valueToSearch2;
+        higherValue = valueToSearch1;
+    }
+
+    rangeSearch(root, lowerValue, higherValue, treeValuesInRange);
+    return treeValuesInRange;
+}
+
+// Appends the values of the subtree between the two parameters to the treeValues vector
+template <class T, int NodeCapacity>
+void BTree<T, NodeCapacity>::rangeSearch(const BTreeNode<T, NodeCapacity> *currentNode, const T valueToSearch1,
+                                          const T valueToSearch2, vector<T> &treeValues) const
+{
+    if (currentNode == nullptr)
+    {
+        return;
+    }
+
+    // Only the keys from the lower bound onwards (and the child before each) can be in range
+    int keyIndex = lowerBound(currentNode, valueToSearch1);
+    for (; keyIndex < currentNode->keyCount; keyIndex++)
+    {
+        if (!currentNode->isLeaf)
+        {
+            rangeSearch(currentNode->children[keyIndex], valueToSearch1, valueToSearch2, treeValues);
+        }
+        if (currentNode->keys[keyIndex] > valueToSearch2)
+        {
+            return;
+        }
+        treeValues.push_back(currentNode->keys[keyIndex]);
+    }
+    if (!currentNode->isLeaf)
+    {
+        rangeSearch(currentNode->children[keyIndex], valueToSearch1, valueToSearch2, treeValues);
+    }
+}
+
+// Appends all of the values of the subtree to the treeValues vector in ascending order
+template <class T, int NodeCapacity>
+void BTree<T, NodeCapacity>::inOrderValues(const BTreeNode<T, NodeCapacity> *currentNode, vector<T> &treeValues) const
+{
+    if (currentNode == nullptr)
+    {
+        return;
+    }
+
+    for (int i = 0; i < currentNode->keyCount; i++)
+    {
+        if (!currentNode->isLeaf)
+        {
+            inOrderValues(currentNode->children[i], treeValues);
+        }
+        treeValues.push_back(currentNode->keys[i]);
+    }
+    if (!currentNode->isLeaf)
+    {
+        inOrderValues(currentNode->children[currentNode->keyCount], treeValues);
+    }
+}
+
+// Returns the size of the tree
+template <class T, int NodeCapacity>
+int BTree<T, NodeCapacity>::size() const
+{
+    return treeSize;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Single thread that runs teardown work handed to it, so the thread that dropped
+// a large structure does not have to wait for it to be freed
+class BackgroundReclaimer
+{
+    // Private attributes and helper methods
+private:
+    std::deque<std::function<void()>> jobs;
+    std::mutex jobMutex;
+    std::condition_variable jobAdded;
+    std::condition_variable jobsFinished;
+    bool running = false; // A job has been taken off the queue but has not finished yet
+    bool stopping = false;
+    std::thread worker;
+    void workerLoop();
+
+    // Public methods
+public:
+    BackgroundReclaimer();
+    BackgroundReclaimer(const BackgroundReclaimer &) = delete;
+    BackgroundReclaimer &operator=(const BackgroundReclaimer &) = delete;
+    ~BackgroundReclaimer();
+    static BackgroundReclaimer &global();
+    void submit(std::function<void()> job);
+    void drain();
+};
+
+// Constructor
+inline BackgroundReclaimer::BackgroundReclaimer() : worker(&BackgroundReclaimer::workerLoop, this)
+{
+}
+
+// Destructor
+// Finishes every job already submitted
+inline BackgroundReclaimer::~BackgroundReclaimer()
+{
+    {
+        std::lock_guard<std::mutex> guard(jobMutex);
+        stopping = true;
+    }
+    jobAdded.notify_all();
+    worker.join();
+}
+
+// Returns the process-wide reclaimer
+// It is never destroyed, so objects torn down during static destruction can still use it;
+// jobs still queued when the process exits are dropped along with the memory they would free
+inline BackgroundReclaimer &BackgroundReclaimer::global()
+{
+    static BackgroundReclaimer *reclaimer = new BackgroundReclaimer();
+    return *reclaimer;
+}
+
+// Queues the job to run on the reclaimer thread
+inline void BackgroundReclaimer::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> guard(jobMutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAdded.notify_one();
+}
+
+// Waits until every job submitted so far has finished
+inline void BackgroundReclaimer::drain()
+{
+    std::unique_lock<std::mutex> lock(jobMutex);
+    jobsFinished.wait(lock, [this]()
+                      { return jobs.empty() && !running; });
+}
+
+// Runs jobs in submission order until the reclaimer is destroyed
+inline void BackgroundReclaimer::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(jobMutex);
+    while (true)
+    {
+        jobAdded.wait(lock, [this]()
+                      { return stopping || !jobs.empty(); });
+        if (jobs.empty())
+        {
+            return;
+        }
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        running = true;
+        lock.unlock();
+        job();
+        lock.lock();
+        running = false;
+        if (jobs.empty())
+        {
+            jobsFinished.notify_all();
+        }
+    }
+}
@@ -0,0 +1,300 @@
+#pragma once
+#include "RedBlackTree.h"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+// Contention counters reported by ScalableSharedMutex
+struct ContentionMetrics
+{
+    long long readAcquisitions = 0;  // Shared locks taken
+    long long writeAcquisitions = 0; // Exclusive locks taken
+    long long readerWaits = 0;       // Times a reader had to wait for a writer
+    long long writerWaits = 0;       // Times a writer had to wait for another writer
+    long long drainWaits = 0;        // Times a writer had to wait for readers to leave
+};
+
+// Reader-writer lock with one reader counter per slot, each on its own cache line
+// Readers only touch their own slot, so concurrent readers do not bounce a shared line
+// A waiting writer blocks new readers (writer preference) and then waits for every slot to drain
+class ScalableSharedMutex
+{
+    // Private attributes and helper methods
+private:
+    static const int slotCount = 64;
+
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<int> readers{0};
+        std::atomic<long long> readAcquisitions{0};
+        std::atomic<long long> readerWaits{0};
+    };
+
+    ReaderSlot slots[slotCount];
+    alignas(64) std::atomic<bool> writerPending{false};
+    std::mutex writerMutex;
+    long long writeAcquisitions = 0; // Only changed while writerMutex is held
+    long long writerWaits = 0;
+    long long drainWaits = 0;
+    static int currentSlot();
+
+    // Public methods
+public:
+    ScalableSharedMutex() = default;
+    ScalableSharedMutex(const ScalableSharedMutex &) = delete;
+    ScalableSharedMutex &operator=(const ScalableSharedMutex &) = delete;
+    void lock();
+    void unlock();
+    void lock_shared();
+    void unlock_shared();
+    ContentionMetrics metrics();
+    void resetMetrics();
+};
+
+// Returns the reader slot of the calling thread
+// Threads are spread over the slots round robin the first time they take a shared lock
+inline int ScalableSharedMutex::currentSlot()
+{
+    static std::atomic<int> nextSlot{0};
+    thread_local int slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % slotCount;
+    return slot;
+}
+
+// Takes the lock for reading
+inline void ScalableSharedMutex::lock_shared()
+{
+    ReaderSlot &slot = slots[currentSlot()];
+    while (true)
+    {
+        // Let a pending writer go first
+        if (writerPending.load(std::memory_order_seq_cst))
+        {
+            slot.readerWaits.fetch_add(1, std::memory_order_relaxed);
+            while (writerPending.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        // Announce the reader, then make sure no writer slipped in before the announcement was seen
+        slot.readers.fetch_add(1, std::memory_order_seq_cst);
+        if (!writerPending.load(std::memory_order_seq_cst))
+        {
+            slot.readAcquisitions.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        slot.readers.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+// Releases a lock taken for reading
+inline void ScalableSharedMutex::unlock_shared()
+{
+    slots[currentSlot()].readers.fetch_sub(1, std::memory_order_release);
+}
+
+// Takes the lock for writing
+inline void ScalableSharedMutex::lock()
+{
+    if (!writerMutex.try_lock())
+    {
+        writerMutex.lock();
+        writerWaits++;
+    }
+
+    // Stop new readers, then wait for the readers already inside to leave
+    writerPending.store(true, std::memory_order_seq_cst);
+    bool waited = false;
+    for (int i = 0; i < slotCount; i++)
+    {
+        while (slots[i].readers.load(std::memory_order_seq_cst) != 0)
+        {
+            waited = true;
+            std::this_thread::yield();
+        }
+    }
+    if (waited)
+    {
+        drainWaits++;
+    }
+    writeAcquisitions++;
+}
+
+// Releases a lock taken for writing
+inline void ScalableSharedMutex::unlock()
+{
+    writerPending.store(false, std::memory_order_release);
+    writerMutex.unlock();
+}
+
+// Returns the contention counters accumulated since construction or the last reset
+inline ContentionMetrics ScalableSharedMutex::metrics()
+{
+    ContentionMetrics totals;
+    for (int i = 0; i < slotCount; i++)
+    {
+        totals.readAcquisitions += slots[i].readAcquisitions.load(std::memory_order_relaxed);
+        totals.readerWaits += slots[i].readerWaits.load(std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> guard(writerMutex);
+    totals.writeAcquisitions = writeAcquisitions;
+    totals.writerWaits = writerWaits;
+    totals.drainWaits = drainWaits;
+    return totals;
+}
+
+// Sets every contention counter back to zero
+inline void ScalableSharedMutex::resetMetrics()
+{
+    for (int i = 0; i < slotCount; i++)
+    {
+        slots[i].readAcquisitions.store(0, std::memory_order_relaxed);
+        slots[i].readerWaits.store(0, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> guard(writerMutex);
+    writeAcquisitions = 0;
+    writerWaits = 0;
+    drainWaits = 0;
+}
+
+// Thread-safe wrapper around RedBlackTree
+// Lookups share the lock and run in parallel; insert, remove and compact take it exclusively
+template <class T, class Allocator = std::allocator<T>>
+class ConcurrentRedBlackTree
+{
+    // Private attributes
+private:
+    RedBlackTree<T, Allocator> tree;
+    mutable ScalableSharedMutex treeLock;
+
+    // Public methods
+public:
+    ConcurrentRedBlackTree();
+    explicit ConcurrentRedBlackTree(const Allocator &allocator);
+    ConcurrentRedBlackTree(const ConcurrentRedBlackTree<T, Allocator> &treeParameter) = delete;
+    ConcurrentRedBlackTree<T, Allocator> &operator=(const ConcurrentRedBlackTree<T, Allocator> &treeParameter) = delete;
+    bool insert(const T valueToStore);
+    bool remove(const T valueToRemove);
+    bool search(const T valueToSearch) const;
+    vector<T> search(const T valueToSearch1, const T valueToSearch2) const;
+    T closestLess(const T valueToCompare) const;
+    T closestGreater(const T valueToCompare) const;
+    vector<T> values() const;
+    int size() const;
+    void compact(NodeLayout layout = NodeLayout::InOrder);
+    RedBlackTree<T, Allocator> copy() const;
+    ContentionMetrics contentionMetrics() const;
+    void resetContentionMetrics();
+};
+
+// Constructor
+template <class T, class Allocator>
+ConcurrentRedBlackTree<T, Allocator>::ConcurrentRedBlackTree()
+{
+}
+
+// Constructor that allocates nodes through the given allocator
+template <class T, class Allocator>
+ConcurrentRedBlackTree<T, Allocator>::ConcurrentRedBlackTree(const Allocator &allocator) : tree(allocator)
+{
+}
+
+// Inserts the value parameter
+// Returns true on success or false if the value is already present
+template <class T, class Allocator>
+bool ConcurrentRedBlackTree<T, Allocator>::insert(const T valueToStore)
+{
+    std::lock_guard<ScalableSharedMutex> guard(treeLock);
+    return tree.insert(valueToStore);
+}
+
+// Removes the value parameter
+// Returns true on success or false if the value is not present
+template <class T, class Allocator>
+bool ConcurrentRedBlackTree<T, Allocator>::remove(const T valueToRemove)
+{
+    std::lock_guard<ScalableSharedMutex> guard(treeLock);
+    return tree.remove(valueToRemove);
+}
+
+// Searches the tree for the provided parameter
+// Returns true if found, false otherwise
+template <class T, class Allocator>
+bool ConcurrentRedBlackTree<T, Allocator>::search(const T valueToSearch) const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.search(valueToSearch);
+}
+
+// Returns a vector containing values between the method's first and second parameters
+template <class T, class Allocator>
+vector<T> ConcurrentRedBlackTree<T, Allocator>::search(const T valueToSearch1, const T valueToSearch2) const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.search(valueToSearch1, valueToSearch2);
+}
+
+// Returns the largest value in the tree that is less than the parameter
+template <class T, class Allocator>
+T ConcurrentRedBlackTree<T, Allocator>::closestLess(const T valueToCompare) const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.closestLess(valueToCompare);
+}
+
+// Returns the smallest value in the tree that is greater than the parameter
+template <class T, class Allocator>
+T ConcurrentRedBlackTree<T, Allocator>::closestGreater(const T valueToCompare) const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.closestGreater(valueToCompare);
+}
+
+// Returns a vector containing all of the values in the tree
+template <class T, class Allocator>
+vector<T> ConcurrentRedBlackTree<T, Allocator>::values() const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.values();
+}
+
+// Returns the size of the tree
+template <class T, class Allocator>
+int ConcurrentRedBlackTree<T, Allocator>::size() const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree.size();
+}
+
+// Relays out the nodes of the tree (see RedBlackTree::compact)
+template <class T, class Allocator>
+void ConcurrentRedBlackTree<T, Allocator>::compact(NodeLayout layout)
+{
+    std::lock_guard<ScalableSharedMutex> guard(treeLock);
+    tree.compact(layout);
+}
+
+// Returns a deep copy of the tree taken while holding the lock for reading
+template <class T, class Allocator>
+RedBlackTree<T, Allocator> ConcurrentRedBlackTree<T, Allocator>::copy() const
+{
+    std::shared_lock<ScalableSharedMutex> guard(treeLock);
+    return tree;
+}
+
+// Returns the lock contention counters
+template <class T, class Allocator>
+ContentionMetrics ConcurrentRedBlackTree<T, Allocator>::contentionMetrics() const
+{
+    return treeLock.metrics();
+}
+
+// Sets the lock contention counters back to zero
+template <class T, class Allocator>
+void ConcurrentRedBlackTree<T, Allocator>::resetContentionMetrics()
+{
+    treeLock.resetMetrics();
+}
@@ -0,0 +1,239 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+using std::vector;
+
+// Epoch-based memory reclamation
+// Readers announce the global epoch they entered in a slot of their own (one cache line per thread),
+// so entering and leaving a read section never writes to a shared line. Memory that writers
+// unlink is retired with the current epoch and freed once every active reader has moved two
+// epochs past it, at which point no reader can still hold a pointer into it
+class EpochDomain
+{
+    // Private attributes and helper methods
+private:
+    static const std::uint64_t inactive = 0;
+
+    struct alignas(64) ThreadRecord
+    {
+        std::atomic<std::uint64_t> localEpoch{inactive};
+        std::atomic<bool> inUse{false};
+        ThreadRecord *next = nullptr;
+        int nesting = 0; // Only touched by the owning thread
+    };
+
+    struct RetiredPointer
+    {
+        void *pointer;
+        void (*deleter)(void *);
+        std::uint64_t epoch;
+    };
+
+    alignas(64) std::atomic<std::uint64_t> globalEpoch{1};
+    std::atomic<ThreadRecord *> records{nullptr};
+    std::mutex retiredMutex;
+    vector<RetiredPointer> retired;
+    int retiredSinceScan = 0;
+    static const int scanThreshold = 64;
+
+    ThreadRecord *acquireRecord();
+    ThreadRecord *currentRecord();
+    bool tryAdvance();
+    void freeRetired(std::uint64_t safeEpoch);
+
+    // Public methods
+public:
+    EpochDomain() = default;
+    EpochDomain(const EpochDomain &) = delete;
+    EpochDomain &operator=(const EpochDomain &) = delete;
+    ~EpochDomain();
+    static EpochDomain &global();
+    void enter();
+    void exit();
+    void retire(void *pointer, void (*deleter)(void *));
+    void reclaim();
+    int pendingCount();
+};
+
+// Keeps the calling thread inside a read section of the domain for the guard's lifetime
+class EpochGuard
+{
+private:
+    EpochDomain &domain;
+
+public:
+    explicit EpochGuard(EpochDomain &guardDomain = EpochDomain::global()) : domain(guardDomain)
+    {
+        domain.enter();
+    }
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard &operator=(const EpochGuard &) = delete;
+    ~EpochGuard()
+    {
+        domain.exit();
+    }
+};
+
+// Destructor
+// Every reader must be gone, so all remaining memory can be freed
+inline EpochDomain::~EpochDomain()
+{
+    for (RetiredPointer &retiredPointer : retired)
+    {
+        retiredPointer.deleter(retiredPointer.pointer);
+    }
+    ThreadRecord *record = records.load();
+    while (record != nullptr)
+    {
+        ThreadRecord *nextRecord = record->next;
+        delete record;
+        record = nextRecord;
+    }
+}
+
+// Returns the process-wide domain
+inline EpochDomain &EpochDomain::global()
+{
+    static EpochDomain domain;
+    return domain;
+}
+
+// Finds a free thread record or adds a new one to the list
+inline EpochDomain::ThreadRecord *EpochDomain::acquireRecord()
+{
+    for (ThreadRecord *record = records.load(std::memory_order_acquire); record != nullptr; record = record->next)
+    {
+        bool expected = false;
+        if (!record->inUse.load(std::memory_order_relaxed) && record->inUse.compare_exchange_strong(expected, true))
+        {
+            return record;
+        }
+    }
+
+    // Records are never unlinked, so pushing onto the head is the only change to the list
+    ThreadRecord *record = new ThreadRecord();
+    record->inUse.store(true, std::memory_order_relaxed);
+    ThreadRecord *head = records.load(std::memory_order_relaxed);
+    do
+    {
+        record->next = head;
+    } while (!records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+    return record;
+}
+
+// Returns the calling thread's record in this domain, acquiring one on first use
+// Records are handed back for reuse when the thread exits, so a domain must outlive the threads that used it
+inline EpochDomain::ThreadRecord *EpochDomain::currentRecord()
+{
+    struct RecordOwner
+    {
+        vector<std::pair<EpochDomain *, ThreadRecord *>> ownedRecords;
+        ~RecordOwner()
+        {
+            for (std::pair<EpochDomain *, ThreadRecord *> &ownedRecord : ownedRecords)
+            {
+                ownedRecord.second->inUse.store(false, std::memory_order_release);
+            }
+        }
+    };
+    thread_local RecordOwner owner;
+    for (std::pair<EpochDomain *, ThreadRecord *> &ownedRecord : owner.ownedRecords)
+    {
+        if (ownedRecord.first == this)
+        {
+            return ownedRecord.second;
+        }
+    }
+    ThreadRecord *record = acquireRecord();
+    owner.ownedRecords.push_back(std::make_pair(this, record));
+    return record;
+}
+
+// Enters a read section; pointers loaded inside it stay valid until the matching exit
+inline void EpochDomain::enter()
+{
+    ThreadRecord *record = currentRecord();
+    if (record->nesting++ == 0)
+    {
+        record->localEpoch.store(globalEpoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+    }
+}
+
+// Leaves a read section
+inline void EpochDomain::exit()
+{
+    ThreadRecord *record = currentRecord();
+    if (--record->nesting == 0)
+    {
+        record->localEpoch.store(inactive, std::memory_order_release);
+    }
+}
+
+// Schedules the pointer to be freed with the deleter once no reader can reach it
+inline void EpochDomain::retire(void *pointer, void (*deleter)(void *))
+{
+    std::lock_guard<std::mutex> guard(retiredMutex);
+    retired.push_back(RetiredPointer{pointer, deleter, globalEpoch.load(std::memory_order_seq_cst)});
+    if (++retiredSinceScan >= scanThreshold)
+    {
+        retiredSinceScan = 0;
+        tryAdvance();
+        freeRetired(globalEpoch.load(std::memory_order_acquire));
+    }
+}
+
+// Moves the global epoch forward if every active reader has caught up with it
+// Must be called with retiredMutex held
+inline bool EpochDomain::tryAdvance()
+{
+    std::uint64_t currentEpoch = globalEpoch.load(std::memory_order_seq_cst);
+    for (ThreadRecord *record = records.load(std::memory_order_acquire); record != nullptr; record = record->next)
+    {
+        std::uint64_t readerEpoch = record->localEpoch.load(std::memory_order_seq_cst);
+        if (readerEpoch != inactive && readerEpoch != currentEpoch)
+        {
+            return false;
+        }
+    }
+    globalEpoch.store(currentEpoch + 1, std::memory_order_seq_cst);
+    return true;
+}
+
+// Frees everything retired at least two epochs before the given epoch
+// Must be called with retiredMutex held
+inline void EpochDomain::freeRetired(std::uint64_t safeEpoch)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < retired.size(); i++)
+    {
+        if (retired[i].epoch + 2 <= safeEpoch)
+        {
+            retired[i].deleter(retired[i].pointer);
+        }
+        else
+        {
+            retired[kept++] = retired[i];
+        }
+    }
+    retired.resize(kept);
+}
+
+// Frees whatever can be freed right now, advancing the epoch as far as the active readers allow
+inline void EpochDomain::reclaim()
+{
+    std::lock_guard<std::mutex> guard(retiredMutex);
+    tryAdvance();
+    tryAdvance();
+    freeRetired(globalEpoch.load(std::memory_order_acquire));
+    retiredSinceScan = 0;
+}
+
+// Returns the number of retired pointers that have not been freed yet
+inline int EpochDomain::pendingCount()
+{
+    std::lock_guard<std::mutex> guard(retiredMutex);
+    return retired.size();
+}
@@ -0,0 +1,292 @@
+#pragma once
+#include "PersistentNode.h"
+#include "EpochReclamation.h"
+#include <mutex>
+
+// Reclaimer that defers freeing a node until no reader of the global epoch domain can reach it
+template <class T>
+class EpochReclaimer
+{
+public:
+    static void dispose(PersistentNodeT<T> *nodeToDispose)
+    {
+        EpochDomain::global().retire(nodeToDispose, &EpochReclaimer<T>::deleteNode);
+    }
+
+    static void deleteNode(void *nodeToDelete)
+    {
+        delete static_cast<PersistentNodeT<T> *>(nodeToDelete);
+    }
+};
+
+// Immutable view of one version of an EpochRedBlackTree
+// It holds counted references to that version's nodes, so it stays valid and unchanged for as long
+// as it lives while writers carry on; copying a snapshot is O(1)
+template <class T>
+class RedBlackTreeSnapshot
+{
+    // Private attributes
+private:
+    using Ops = PersistentRedBlackOps<T, EpochReclaimer<T>>;
+    using Ref = PersistentNodeRef<T, EpochReclaimer<T>>;
+
+    Ref root;
+    int treeSize;
+    template <class Visitor>
+    static void visitInOrder(const PersistentNodeT<T> *currentNode, Visitor &visitor);
+
+    // Public methods
+public:
+    RedBlackTreeSnapshot(Ref snapshotRoot, int snapshotSize) : root(std::move(snapshotRoot)), treeSize(snapshotSize){};
+    bool search(const T valueToSearch) const;
+    vector<T> search(const T valueToSearch1, const T valueToSearch2) const;
+    T closestLess(const T valueToCompare) const;
+    T closestGreater(const T valueToCompare) const;
+    vector<T> values() const;
+    int size() const;
+    template <class Visitor>
+    void forEach(Visitor visitor) const;
+};
+
+// Red-Black tree with lock-free readers and one writer at a time
+// Writers build each new version by copying the O(log n) path they change and publish it
+// with a single atomic store; readers load the published root inside an epoch and walk
+// nodes that never change, so they take no locks and make no atomic writes to shared lines.
+// Nodes dropped from the tree are reclaimed through the epoch domain rather than deleted at once
+template <class T>
+class EpochRedBlackTree
+{
+    // Private attributes
+private:
+    using Ops = PersistentRedBlackOps<T, EpochReclaimer<T>>;
+    using Ref = PersistentNodeRef<T, EpochReclaimer<T>>;
+
+    std::atomic<PersistentNodeT<T> *> publishedRoot; // What readers see
+    Ref writerRoot;                                  // The writer's reference to the same version
+    std::atomic<int> treeSize;
+    std::mutex writerMutex;
+    void publish(Ref newRoot);
+
+    // Public methods
+public:
+    EpochRedBlackTree();
+    EpochRedBlackTree(const EpochRedBlackTree<T> &treeParameter) = delete;
+    EpochRedBlackTree<T> &operator=(const EpochRedBlackTree<T> &treeParameter) = delete;
+    ~EpochRedBlackTree();
+    bool insert(const T valueToStore);
+    bool remove(const T valueToRemove);
+    bool search(const T valueToSearch) const;
+    vector<T> search(const T valueToSearch1, const T valueToSearch2) const;
+    T closestLess(const T valueToCompare) const;
+    T closestGreater(const T valueToCompare) const;
+    vector<T> values() const;
+    int size() const;
+    RedBlackTreeSnapshot<T> snapshot();
+};
+
+// Constructor
+template <class T>
+EpochRedBlackTree<T>::EpochRedBlackTree() : publishedRoot(nullptr), treeSize(0)
+{
+}
+
+// Destructor
+// Readers must be done with the tree; its nodes are retired like any other removed node
+template <class T>
+EpochRedBlackTree<T>::~EpochRedBlackTree()
+{
+    publishedRoot.store(nullptr, std::memory_order_release);
+    writerRoot = Ref();
+}
+
+// Makes the new version visible to readers, then drops the writer's reference to the old one
+// Nodes only the old version used are retired when their last reference goes away
+template <class T>
+void EpochRedBlackTree<T>::publish(Ref newRoot)
+{
+    publishedRoot.store(newRoot.get(), std::memory_order_release);
+    writerRoot = std::move(newRoot);
+}
+
+// Inserts the value parameter into the tree
+// Returns true on success or false if the value is already present
+template <class T>
+bool EpochRedBlackTree<T>::insert(const T valueToStore)
+{
+    std::lock_guard<std::mutex> guard(writerMutex);
+    if (Ops::find(writerRoot.get(), valueToStore) != nullptr)
+    {
+        return false;
+    }
+    publish(Ops::insert(writerRoot, valueToStore));
+    treeSize.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Removes the value parameter from the tree
+// Returns true on success or false if the value is not present
+template <class T>
+bool EpochRedBlackTree<T>::remove(const T valueToRemove)
+{
+    std::lock_guard<std::mutex> guard(writerMutex);
+    if (Ops::find(writerRoot.get(), valueToRemove) == nullptr)
+    {
+        return false;
+    }
+    publish(Ops::remove(writerRoot, valueToRemove));
+    treeSize.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Searches the tree for the provided parameter without locking
+// Returns true if found, false otherwise
+template <class T>
+bool EpochRedBlackTree<T>::search(const T valueToSearch) const
+{
+    EpochGuard guard;
+    return Ops::find(publishedRoot.load(std::memory_order_acquire), valueToSearch) != nullptr;
+}
+
+// Returns a vector containing values between the method's first and second parameters
+// All of the values come from one consistent version of the tree
+template <class T>
+vector<T> EpochRedBlackTree<T>::search(const T valueToSearch1, const T valueToSearch2) const
+{
+    vector<T> treeValuesInRange;
+    EpochGuard guard;
+    if (valueToSearch1 > valueToSearch2)
+    {
+        Ops::rangeSearch(publishedRoot.load(std::memory_order_acquire), valueToSearch2, valueToSearch1, treeValuesInRange);
+    }
+    else
+    {
+        Ops::rangeSearch(publishedRoot.load(std::memory_order_acquire), valueToSearch1, valueToSearch2, treeValuesInRange);
+    }
+    return treeValuesInRange;
+}
+
+// Returns the largest value in the tree that is less than the parameter
+// Returns the parameter if there is no such value
+template <class T>
+T EpochRedBlackTree<T>::closestLess(const T valueToCompare) const
+{
+    EpochGuard guard;
+    const PersistentNodeT<T> *closestNode = Ops::closestLess(publishedRoot.load(std::memory_order_acquire), valueToCompare);
+    return closestNode == nullptr ? valueToCompare : closestNode->data;
+}
+
+// Returns the smallest value in the tree that is greater than the parameter
+// Returns the parameter if there is no such value
+template <class T>
+T EpochRedBlackTree<T>::closestGreater(const T valueToCompare) const
+{
+    EpochGuard guard;
+    const PersistentNodeT<T> *closestNode = Ops::closestGreater(publishedRoot.load(std::memory_order_acquire), valueToCompare);
+    return closestNode == nullptr ? valueToCompare : closestNode->data;
+}
+
+// Returns a vector containing all of the values of one consistent version in ascending order
+template <class T>
+vector<T> EpochRedBlackTree<T>::values() const
+{
+    vector<T> treeValues;
+    EpochGuard guard;
+    Ops::inOrderValues(publishedRoot.load(std::memory_order_acquire), treeValues);
+    return treeValues;
+}
+
+// Returns the number of values in the tree
+template <class T>
+int EpochRedBlackTree<T>::size() const
+{
+    return treeSize.load(std::memory_order_relaxed);
+}
+
+// Returns an immutable view of the current version of the tree
+// Writers are only held up for the O(1) it takes to share the current root
+template <class T>
+RedBlackTreeSnapshot<T> EpochRedBlackTree<T>::snapshot()
+{
+    std::lock_guard<std::mutex> guard(writerMutex);
+    return RedBlackTreeSnapshot<T>(writerRoot, treeSize.load(std::memory_order_relaxed));
+}
+
+// Searches the snapshot for the provided parameter
+// Returns true if found, false otherwise
+template <class T>
+bool RedBlackTreeSnapshot<T>::search(const T valueToSearch) const
+{
+    return Ops::find(root.get(), valueToSearch) != nullptr;
+}
+
+// Returns a vector containing the snapshot's values between the method's first and second parameters
+template <class T>
+vector<T> RedBlackTreeSnapshot<T>::search(const T valueToSearch1, const T valueToSearch2) const
+{
+    vector<T> treeValuesInRange;
+    if (valueToSearch1 > valueToSearch2)
+    {
+        Ops::rangeSearch(root.get(), valueToSearch2, valueToSearch1, treeValuesInRange);
+    }
+    else
+    {
+        Ops::rangeSearch(root.get(), valueToSearch1, valueToSearch2, treeValuesInRange);
+    }
+    return treeValuesInRange;
+}
+
+// Returns the largest value in the snapshot that is less than the parameter
+// Returns the parameter if there is no such value
+template <class T>
+T RedBlackTreeSnapshot<T>::closestLess(const T valueToCompare) const
+{
+    const PersistentNodeT<T> *closestNode = Ops::closestLess(root.get(), valueToCompare);
+    return closestNode == nullptr ? valueToCompare : closestNode->data;
+}
+
+// Returns the smallest value in the snapshot that is greater than the parameter
+// Returns the parameter if there is no such value
+template <class T>
+T RedBlackTreeSnapshot<T>::closestGreater(const T valueToCompare) const
+{
+    const PersistentNodeT<T> *closestNode = Ops::closestGreater(root.get(), valueToCompare);
+    return closestNode == nullptr ? valueToCompare : closestNode->data;
+}
+
+// Returns a vector containing all of the snapshot's values in ascending order
+template <class T>
+vector<T> RedBlackTreeSnapshot<T>::values() const
+{
+    vector<T> treeValues;
+    treeValues.reserve(treeSize);
+    Ops::inOrderValues(root.get(), treeValues);
+    return treeValues;
+}
+
+// Returns the number of values in the snapshot
+template <class T>
+int RedBlackTreeSnapshot<T>::size() const
+{
+    return treeSize;
+}
+
+// Calls visitor with each of the snapshot's values in ascending order, without copying them into a vector
+template <class T>
+template <class Visitor>
+void RedBlackTreeSnapshot<T>::forEach(Visitor visitor) const
+{
+    visitInOrder(root.get(), visitor);
+}
+
+// Calls visitor with each value of the subtree in ascending order
+template <class T>
+template <class Visitor>
+void RedBlackTreeSnapshot<T>::visitInOrder(const PersistentNodeT<T> *currentNode, Visitor &visitor)
+{
+    if (currentNode != nullptr)
+    {
+        visitInOrder(currentNode->left, visitor);
+        visitor(currentNode->data);
+        visitInOrder(currentNode->right, visitor);
+    }
+}
@@ -0,0 +1,314 @@
+#pragma once
+#include "RedBlackTree.h"
+
+// Red-Black tree with a small-size optimisation
+// Up to SmallCapacity values are kept in an inline sorted array, so small sets never allocate nodes
+// The values move into a RedBlackTree once the array overflows and move back once the tree
+// shrinks to half of SmallCapacity (the gap stops a set on the boundary from converting back and forth)
+template <class T, int SmallCapacity = 32>
+class HybridRedBlackTree
+{
+    static_assert(SmallCapacity >= 2, "HybridRedBlackTree needs room for at least two inline values");
+
+    // Private attributes and helper methods
+private:
+    T smallValues[SmallCapacity];
+    int smallCount;
+    RedBlackTree<T> *largeTree; // nullptr while the values are stored inline
+    int smallPosition(const T valueToSearch) const;
+    void convertToTree();
+    void convertToArray();
+
+    // Public methods
+public:
+    HybridRedBlackTree();
+    HybridRedBlackTree(const HybridRedBlackTree<T, SmallCapacity> &treeParameter);
+    HybridRedBlackTree<T, SmallCapacity> &operator=(const HybridRedBlackTree<T, SmallCapacity> &treeParameter);
+    ~HybridRedBlackTree();
+    bool insert(const T valueToStore);
+    bool remove(const T valueToRemove);
+    bool search(const T valueToSearch) const;
+    vector<T> search(const T valueToSearch1, const T valueToSearch2) const;
+    T closestLess(const T valueToCompare) const;
+    T closestGreater(const T valueToCompare) const;
+    vector<T> values() const;
+    int size() const;
+    bool isInline() const;
+};
+
+// Constructor
+template <class T, int SmallCapacity>
+HybridRedBlackTree<T, SmallCapacity>::HybridRedBlackTree()
+{
+    // Start with an empty inline array
+    smallCount = 0;
+    largeTree = nullptr;
+}
+
+// Copy constructor
+template <class T, int SmallCapacity>
+HybridRedBlackTree<T, SmallCapacity>::HybridRedBlackTree(const HybridRedBlackTree<T, SmallCapacity> &treeParameter)
+{
+    smallCount = treeParameter.smallCount;
+    for (int i = 0; i < smallCount; i++)
+    {
+        smallValues[i] = treeParameter.smallValues[i];
+    }
+
+    // Deep copies the tree if the parameter has outgrown its inline array
+    largeTree = nullptr;
+    if (treeParameter.largeTree != nullptr)
+    {
+        largeTree = new RedBlackTree<T>(*treeParameter.largeTree);
+    }
+}
+
+// Overloads the assignment operator for HybridRedBlackTree
+template <class T, int SmallCapacity>
+HybridRedBlackTree<T, SmallCapacity> &HybridRedBlackTree<T, SmallCapacity>::operator=(const HybridRedBlackTree<T, SmallCapacity> &treeParameter)
+{
+    // If the calling object is the parameter, the operator should not copy it
+    if (this != &treeParameter)
+    {
+        delete largeTree;
+        largeTree = nullptr;
+
+        smallCount = treeParameter.smallCount;
+        for (int i = 0; i < smallCount; i++)
+        {
+            smallValues[i] = treeParameter.smallValues[i];
+        }
+        if (treeParameter.largeTree != nullptr)
+        {
+            largeTree = new RedBlackTree<T>(*treeParameter.largeTree);
+        }
+    }
+    // Returns a reference to the calling object
+    return *this;
+}
+
+// Destructor
+template <class T, int SmallCapacity>
+HybridRedBlackTree<T, SmallCapacity>::~HybridRedBlackTree()
+{
+    delete largeTree;
+    largeTree = nullptr;
+    smallCount = 0;
+}
+
+// Returns the index of the first inline value that is not less than the parameter
+template <class T, int SmallCapacity>
+int HybridRedBlackTree<T, SmallCapacity>::smallPosition(const T valueToSearch) const
+{
+    // A linear scan over a few contiguous values beats a binary search's unpredictable branches
+    int position = 0;
+    while (position < smallCount && smallValues[position] < valueToSearch)
+    {
+        position++;
+    }
+    return position;
+}
+
+// Moves the inline values into a newly allocated RedBlackTree
+template <class T, int SmallCapacity>
+void HybridRedBlackTree<T, SmallCapacity>::convertToTree()
+{
+    largeTree = new RedBlackTree<T>();
+    for (int i = 0; i < smallCount; i++)
+    {
+        largeTree->insert(smallValues[i]);
+    }
+    smallCount = 0;
+}
+
+// Moves the tree values back into the inline array and frees the tree
+template <class T, int SmallCapacity>
+void HybridRedBlackTree<T, SmallCapacity>::convertToArray()
+{
+    vector<T> treeValues = largeTree->values();
+    smallCount = treeValues.size();
+    for (int i = 0; i < smallCount; i++)
+    {
+        smallValues[i] = treeValues[i];
+    }
+    delete largeTree;
+    largeTree = nullptr;
+}
+
+// Inserts the value parameter
+// Returns true on success or false if the value is already present
+template <class T, int SmallCapacity>
+bool HybridRedBlackTree<T, SmallCapacity>::insert(const T valueToStore)
+{
+    if (largeTree != nullptr)
+    {
+        return largeTree->insert(valueToStore);
+    }
+
+    int position = smallPosition(valueToStore);
+    if (position < smallCount && smallValues[position] == valueToStore)
+    {
+        return false;
+    }
+
+    // The inline array is full, so switch to the tree representation
+    if (smallCount == SmallCapacity)
+    {
+        convertToTree();
+        return largeTree->insert(valueToStore);
+    }
+
+    // Shift the larger values right to keep the array sorted
+    for (int i = smallCount; i > position; i--)
+    {
+        smallValues[i] = smallValues[i - 1];
+    }
+    smallValues[position] = valueToStore;
+    smallCount++;
+    return true;
+}
+
+// Removes the value parameter
+// Returns true on success or false if the value is not present
+template <class T, int SmallCapacity>
+bool HybridRedBlackTree<T, SmallCapacity>::remove(const T valueToRemove)
+{
+    if (largeTree != nullptr)
+    {
+        if (!largeTree->remove(valueToRemove))
+        {
+            return false;
+        }
+
+        // The tree has shrunk enough to fit comfortably back inline
+        if (largeTree->size() <= SmallCapacity / 2)
+        {
+            convertToArray();
+        }
+        return true;
+    }
+
+    int position = smallPosition(valueToRemove);
+    if (position == smallCount || !(smallValues[position] == valueToRemove))
+    {
+        return false;
+    }
+
+    // Shift the larger values left to close the gap
+    for (int i = position + 1; i < smallCount; i++)
+    {
+        smallValues[i - 1] = smallValues[i];
+    }
+    smallCount--;
+    return true;
+}
+
+// Searches for the provided parameter
+// Returns true if found, false otherwise
+template <class T, int SmallCapacity>
+bool HybridRedBlackTree<T, SmallCapacity>::search(const T valueToSearch) const
+{
+    if (largeTree != nullptr)
+    {
+        return largeTree->search(valueToSearch);
+    }
+
+    int position = smallPosition(valueToSearch);
+    return position < smallCount && smallValues[position] == valueToSearch;
+}
+
+// Returns a vector containing values between the method's first and second parameters
+// The vector is in ascending order
+template <class T, int SmallCapacity>
+vector<T> HybridRedBlackTree<T, SmallCapacity>::search(const T valueToSearch1, const T valueToSearch2) const
+{
+    if (largeTree != nullptr)
+    {
+        return largeTree->search(valueToSearch1, valueToSearch2);
+    }
+
+    // Determine which parameter value is lower and greater (bounds)
+    T lowerValue = valueToSearch1;
+    T higherValue = valueToSearch2;
+    if (valueToSearch1 > valueToSearch2)
+    {
+        lowerValue = valueToSearch2;
+        higherValue = valueToSearch1;
+    }
+
+    vector<T> valuesInRange;
+    for (int i = smallPosition(lowerValue); i < smallCount && smallValues[i] <= higherValue; i++)
+    {
+        valuesInRange.push_back(smallValues[i]);
+    }
+    return valuesInRange;
+}
+
+// Returns the largest stored value that is less than the parameter
+template <class T, int SmallCapacity>
+T HybridRedBlackTree<T, SmallCapacity>::closestLess(const T valueToCompare) const
+{
+    if (largeTree != nullptr)
+    {
+        return largeTree->closestLess(valueToCompare);
+    }
+
+    // The value before the first value not less than the parameter is the closest one
+    int position = smallPosition(valueToCompare);
+    if (position == 0)
+    {
+        return valueToCompare;
+    }
+    return smallValues[position - 1];
+}
+
+// Returns the smallest stored value that is greater than the parameter
+template <class T, int SmallCapacity>
+T HybridRedBlackTree<T, SmallCapacity>::closestGreater(const T valueToCompare) const
+{
+    if (largeTree != nullptr)
+    {
+        return largeTree->closestGreater(valueToCompare);
+    }
+
+    // Skip over a value equal to the parameter
+    int position = smallPosition(valueToCompare);
+    if (position < smallCount && smallValues[position] == valueToCompare)
+    {
+        position++;
+    }
+    if (position == smallCount)
+    {
+        return valueToCompare;
+    }
+    return smallValues[position];
+}
+
+// Returns a vector containing all of the values in ascending order
+template <class T, int SmallCapacity>
+vector<T> HybridRedBlackTree<T, SmallCapacity>::values() const
+{
+    if (largeTree != nullptr)
+    {
+        return largeTree->values();
+    }
+    return vector<T>(smallValues, smallValues + smallCount);
+}
+
+// Returns the number of values stored
+template <class T, int SmallCapacity>
+int HybridRedBlackTree<T, SmallCapacity>::size() const
+{
+    if (largeTree != nullptr)
+    {
+        return largeTree->size();
+    }
+    return smallCount;
+}
+
+// Returns true while the values are stored in the inline array
+template <class T, int SmallCapacity>
+bool HybridRedBlackTree<T, SmallCapacity>::isInline() const
+{
+    return largeTree == nullptr;
+}
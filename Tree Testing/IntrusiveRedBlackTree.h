@@ -0,0 +1,589 @@
+#pragma once
+#include <functional>
+#include <vector>
+using std::vector;
+
+// RedBlackTreeHook class
+// Embedded in user objects so an IntrusiveRedBlackTree can link them without allocating nodes
+// An object with several hooks can be stored in several trees at once
+template <class T>
+class RedBlackTreeHook
+{
+public:
+    T *left;
+    T *right;
+    T *parent;
+    bool isBlack;
+
+    // RedBlackTreeHook Constructor
+    RedBlackTreeHook() : left(nullptr), right(nullptr), parent(nullptr), isBlack(false){};
+};
+
+// Red-Black tree that links caller-owned objects through their embedded Hook member
+// Objects are ordered by Compare, so trees on different hooks can order the same objects differently
+// (by price in one and by id in another); two objects are equal when neither orders before the other.
+// The tree never allocates or copies values; objects must outlive their membership in the tree
+// and must not change their ordering while they are linked
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare = std::less<T>>
+class IntrusiveRedBlackTree
+{
+    // Private attributes and helper methods
+private:
+    T *root;
+    int treeSize;
+    Compare compare;
+    static RedBlackTreeHook<T> &hook(T *object);
+    bool isEquivalent(const T &first, const T &second) const;
+    static bool isBlackNode(T *object);
+    T *findObject(const T &key) const;
+    void rotateLeft(T *objectToRotate);
+    void rotateRight(T *objectToRotate);
+    void insertFix(T *objectToStore);
+    void transplant(T *objectToReplace, T *replacement);
+    void removeFix(T *currentObject, T *currentParent);
+    void unlinkTree(T *currentObject);
+    void inOrderObjects(T *currentObject, vector<T *> &treeObjects) const;
+    void rangeSearch(T *currentObject, const T &lowerKey, const T &higherKey, vector<T *> &treeObjects) const;
+
+    // Public methods
+public:
+    explicit IntrusiveRedBlackTree(const Compare &compare = Compare());
+    IntrusiveRedBlackTree(const IntrusiveRedBlackTree<T, Hook, Compare> &treeParameter) = delete;
+    IntrusiveRedBlackTree<T, Hook, Compare> &operator=(const IntrusiveRedBlackTree<T, Hook, Compare> &treeParameter) = delete;
+    ~IntrusiveRedBlackTree();
+    bool insert(T &objectToStore);
+    bool remove(T &objectToRemove);
+    bool search(const T &key) const;
+    T *find(const T &key) const;
+    vector<T *> search(const T &key1, const T &key2) const;
+    T *closestLess(const T &key) const;
+    T *closestGreater(const T &key) const;
+    vector<T *> values() const;
+    int size() const;
+    void clear();
+};
+
+// Constructor
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+IntrusiveRedBlackTree<T, Hook, Compare>::IntrusiveRedBlackTree(const Compare &compare) : compare(compare)
+{
+    // Create an empty tree
+    root = nullptr;
+    treeSize = 0;
+}
+
+// Destructor
+// Unlinks every object so it can be inserted into another tree
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+IntrusiveRedBlackTree<T, Hook, Compare>::~IntrusiveRedBlackTree()
+{
+    clear();
+}
+
+// Returns the hook this tree uses inside the object
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+RedBlackTreeHook<T> &IntrusiveRedBlackTree<T, Hook, Compare>::hook(T *object)
+{
+    return object->*Hook;
+}
+
+// Returns true if neither object orders before the other
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+bool IntrusiveRedBlackTree<T, Hook, Compare>::isEquivalent(const T &first, const T &second) const
+{
+    return !compare(first, second) && !compare(second, first);
+}
+
+// Returns true if the object is black; missing (null) children count as black
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+bool IntrusiveRedBlackTree<T, Hook, Compare>::isBlackNode(T *object)
+{
+    return object == nullptr || hook(object).isBlack;
+}
+
+// Links the object into the tree
+// Returns true on success or false if an equal object is already present
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+bool IntrusiveRedBlackTree<T, Hook, Compare>::insert(T &objectToStore)
+{
+    // Find the parent of the new leaf
+    T *parentObject = nullptr;
+    T *currentObject = root;
+    while (currentObject != nullptr)
+    {
+        if (isEquivalent(objectToStore, *currentObject))
+        {
+            return false;
+        }
+        parentObject = currentObject;
+        currentObject = compare(objectToStore, *currentObject) ? hook(currentObject).left : hook(currentObject).right;
+    }
+
+    // Link the object as a red leaf
+    RedBlackTreeHook<T> &newHook = hook(&objectToStore);
+    newHook.left = nullptr;
+    newHook.right = nullptr;
+    newHook.parent = parentObject;
+    newHook.isBlack = false;
+    if (parentObject == nullptr)
+    {
+        root = &objectToStore;
+    }
+    else if (compare(objectToStore, *parentObject))
+    {
+        hook(parentObject).left = &objectToStore;
+    }
+    else
+    {
+        hook(parentObject).right = &objectToStore;
+    }
+
+    insertFix(&objectToStore);
+    treeSize++;
+    return true;
+}
+
+// Fixes the Red-Black Tree after an object is linked
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+void IntrusiveRedBlackTree<T, Hook, Compare>::insertFix(T *objectToStore)
+{
+    // Continue while the object and its parent are both red
+    while (objectToStore != root && !isBlackNode(objectToStore) && !isBlackNode(hook(objectToStore).parent))
+    {
+        T *objectParent = hook(objectToStore).parent;
+        T *objectGrandParent = hook(objectParent).parent;
+
+        if (objectParent == hook(objectGrandParent).left)
+        {
+            T *objectUncle = hook(objectGrandParent).right;
+
+            // The uncle is red, so recolour and move towards the grandparent
+            if (!isBlackNode(objectUncle))
+            {
+                hook(objectParent).isBlack = true;
+                hook(objectUncle).isBlack = true;
+                hook(objectGrandParent).isBlack = false;
+                objectToStore = objectGrandParent;
+            }
+            else
+            {
+                // The uncle is black, so arrange the objects in a line and rotate the grandparent
+                if (objectToStore == hook(objectParent).right)
+                {
+                    rotateLeft(objectParent);
+                    objectToStore = objectParent;
+                    objectParent = hook(objectToStore).parent;
+                }
+                hook(objectParent).isBlack = true;
+                hook(objectGrandParent).isBlack = false;
+                rotateRight(objectGrandParent);
+                objectToStore = objectParent;
+            }
+        }
+        else // Symmetric to the above
+        {
+            T *objectUncle = hook(objectGrandParent).left;
+            if (!isBlackNode(objectUncle))
+            {
+                hook(objectParent).isBlack = true;
+                hook(objectUncle).isBlack = true;
+                hook(objectGrandParent).isBlack = false;
+                objectToStore = objectGrandParent;
+            }
+            else
+            {
+                if (objectToStore == hook(objectParent).left)
+                {
+                    rotateRight(objectParent);
+                    objectToStore = objectParent;
+                    objectParent = hook(objectToStore).parent;
+                }
+                hook(objectParent).isBlack = true;
+                hook(objectGrandParent).isBlack = false;
+                rotateLeft(objectGrandParent);
+                objectToStore = objectParent;
+            }
+        }
+    }
+
+    hook(root).isBlack = true;
+}
+
+// Unlinks the object from the tree
+// Returns true on success or false if this object is not in the tree
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+bool IntrusiveRedBlackTree<T, Hook, Compare>::remove(T &objectToRemove)
+{
+    // An equal but different object does not count
+    T *removedObject = findObject(objectToRemove);
+    if (removedObject != &objectToRemove)
+    {
+        return false;
+    }
+
+    // Objects cannot swap their values like NodeT does, so the successor is relinked
+    // into the removed object's position instead
+    T *replacedObject = removedObject;
+    bool removedBlack = hook(replacedObject).isBlack;
+    T *childObject;
+    T *childParent;
+
+    if (hook(removedObject).left == nullptr)
+    {
+        childObject = hook(removedObject).right;
+        childParent = hook(removedObject).parent;
+        transplant(removedObject, childObject);
+    }
+    else if (hook(removedObject).right == nullptr)
+    {
+        childObject = hook(removedObject).left;
+        childParent = hook(removedObject).parent;
+        transplant(removedObject, childObject);
+    }
+    else
+    {
+        // The successor is the smallest object in the right subtree
+        replacedObject = hook(removedObject).right;
+        while (hook(replacedObject).left != nullptr)
+        {
+            replacedObject = hook(replacedObject).left;
+        }
+        removedBlack = hook(replacedObject).isBlack;
+        childObject = hook(replacedObject).right;
+
+        if (hook(replacedObject).parent == removedObject)
+        {
+            childParent = replacedObject;
+        }
+        else
+        {
+            childParent = hook(replacedObject).parent;
+            transplant(replacedObject, childObject);
+            hook(replacedObject).right = hook(removedObject).right;
+            hook(hook(replacedObject).right).parent = replacedObject;
+        }
+
+        // The successor takes the removed object's place and colour
+        transplant(removedObject, replacedObject);
+        hook(replacedObject).left = hook(removedObject).left;
+        hook(hook(replacedObject).left).parent = replacedObject;
+        hook(replacedObject).isBlack = hook(removedObject).isBlack;
+    }
+
+    // Removing a black object shortens one path, so restore the black height
+    if (removedBlack)
+    {
+        removeFix(childObject, childParent);
+    }
+
+    hook(removedObject) = RedBlackTreeHook<T>();
+    treeSize--;
+    return true;
+}
+
+// Puts the replacement (which may be null) where objectToReplace was attached
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+void IntrusiveRedBlackTree<T, Hook, Compare>::transplant(T *objectToReplace, T *replacement)
+{
+    T *objectParent = hook(objectToReplace).parent;
+    if (objectParent == nullptr)
+    {
+        root = replacement;
+    }
+    else if (objectToReplace == hook(objectParent).left)
+    {
+        hook(objectParent).left = replacement;
+    }
+    else
+    {
+        hook(objectParent).right = replacement;
+    }
+
+    if (replacement != nullptr)
+    {
+        hook(replacement).parent = objectParent;
+    }
+}
+
+// Fixes the Red-Black Tree when a black object is unlinked
+// currentObject (which may be null) carries the missing black, currentParent is its parent
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+void IntrusiveRedBlackTree<T, Hook, Compare>::removeFix(T *currentObject, T *currentParent)
+{
+    while (currentObject != root && isBlackNode(currentObject))
+    {
+        if (currentObject == hook(currentParent).left)
+        {
+            T *objectSibling = hook(currentParent).right;
+
+            // The sibling is red, so rotate to get a black sibling
+            if (!isBlackNode(objectSibling))
+            {
+                hook(objectSibling).isBlack = true;
+                hook(currentParent).isBlack = false;
+                rotateLeft(currentParent);
+                objectSibling = hook(currentParent).right;
+            }
+
+            // The sibling's children are both black, so push the problem up the tree
+            if (isBlackNode(hook(objectSibling).left) && isBlackNode(hook(objectSibling).right))
+            {
+                hook(objectSibling).isBlack = false;
+                currentObject = currentParent;
+                currentParent = hook(currentObject).parent;
+            }
+            else
+            {
+                // Make sure the sibling's far child is red
+                if (isBlackNode(hook(objectSibling).right))
+                {
+                    hook(hook(objectSibling).left).isBlack = true;
+                    hook(objectSibling).isBlack = false;
+                    rotateRight(objectSibling);
+                    objectSibling = hook(currentParent).right;
+                }
+
+                hook(objectSibling).isBlack = hook(currentParent).isBlack;
+                hook(currentParent).isBlack = true;
+                hook(hook(objectSibling).right).isBlack = true;
+                rotateLeft(currentParent);
+                currentObject = root;
+            }
+        }
+        else // Symmetric to the above
+        {
+            T *objectSibling = hook(currentParent).left;
+            if (!isBlackNode(objectSibling))
+            {
+                hook(objectSibling).isBlack = true;
+                hook(currentParent).isBlack = false;
+                rotateRight(currentParent);
+                objectSibling = hook(currentParent).left;
+            }
+
+            if (isBlackNode(hook(objectSibling).left) && isBlackNode(hook(objectSibling).right))
+            {
+                hook(objectSibling).isBlack = false;
+                currentObject = currentParent;
+                currentParent = hook(currentObject).parent;
+            }
+            else
+            {
+                if (isBlackNode(hook(objectSibling).left))
+                {
+                    hook(hook(objectSibling).right).isBlack = true;
+                    hook(objectSibling).isBlack = false;
+                    rotateLeft(objectSibling);
+                    objectSibling = hook(currentParent).left;
+                }
+
+                hook(objectSibling).isBlack = hook(currentParent).isBlack;
+                hook(currentParent).isBlack = true;
+                hook(hook(objectSibling).left).isBlack = true;
+                rotateRight(currentParent);
+                currentObject = root;
+            }
+        }
+    }
+
+    if (currentObject != nullptr)
+    {
+        hook(currentObject).isBlack = true;
+    }
+}
+
+// Performs a left rotation on the given object
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+void IntrusiveRedBlackTree<T, Hook, Compare>::rotateLeft(T *objectToRotate)
+{
+    T *childObject = hook(objectToRotate).right;
+    hook(objectToRotate).right = hook(childObject).left;
+    if (hook(childObject).left != nullptr)
+    {
+        hook(hook(childObject).left).parent = objectToRotate;
+    }
+
+    transplant(objectToRotate, childObject);
+    hook(childObject).left = objectToRotate;
+    hook(objectToRotate).parent = childObject;
+}
+
+// Performs a right rotation on the given object
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+void IntrusiveRedBlackTree<T, Hook, Compare>::rotateRight(T *objectToRotate)
+{
+    T *childObject = hook(objectToRotate).left;
+    hook(objectToRotate).left = hook(childObject).right;
+    if (hook(childObject).right != nullptr)
+    {
+        hook(hook(childObject).right).parent = objectToRotate;
+    }
+
+    transplant(objectToRotate, childObject);
+    hook(childObject).right = objectToRotate;
+    hook(objectToRotate).parent = childObject;
+}
+
+// Returns the linked object equal to the key, or nullptr if there is none
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+T *IntrusiveRedBlackTree<T, Hook, Compare>::findObject(const T &key) const
+{
+    T *currentObject = root;
+    while (currentObject != nullptr)
+    {
+        if (isEquivalent(key, *currentObject))
+        {
+            return currentObject;
+        }
+        currentObject = compare(key, *currentObject) ? hook(currentObject).left : hook(currentObject).right;
+    }
+    return nullptr;
+}
+
+// Searches the tree for an object equal to the key
+// Returns true if found, false otherwise
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+bool IntrusiveRedBlackTree<T, Hook, Compare>::search(const T &key) const
+{
+    return findObject(key) != nullptr;
+}
+
+// Returns the linked object equal to the key, or nullptr if there is none
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+T *IntrusiveRedBlackTree<T, Hook, Compare>::find(const T &key) const
+{
+    return findObject(key);
+}
+
+// Returns the linked objects between the two keys (inclusive) in ascending order
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+vector<T *> IntrusiveRedBlackTree<T, Hook, Compare>::search(const T &key1, const T &key2) const
+{
+    vector<T *> objectsInRange;
+    if (compare(key2, key1))
+    {
+        rangeSearch(root, key2, key1, objectsInRange);
+    }
+    else
+    {
+        rangeSearch(root, key1, key2, objectsInRange);
+    }
+    return objectsInRange;
+}
+
+// Appends the objects of the subtree between the two keys to treeObjects
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+void IntrusiveRedBlackTree<T, Hook, Compare>::rangeSearch(T *currentObject, const T &lowerKey, const T &higherKey,
+                                                          vector<T *> &treeObjects) const
+{
+    if (currentObject == nullptr)
+    {
+        return;
+    }
+    if (compare(lowerKey, *currentObject))
+    {
+        rangeSearch(hook(currentObject).left, lowerKey, higherKey, treeObjects);
+    }
+    if (!compare(*currentObject, lowerKey) && !compare(higherKey, *currentObject))
+    {
+        treeObjects.push_back(currentObject);
+    }
+    if (compare(*currentObject, higherKey))
+    {
+        rangeSearch(hook(currentObject).right, lowerKey, higherKey, treeObjects);
+    }
+}
+
+// Returns the largest linked object that is less than the key, or nullptr if there is none
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+T *IntrusiveRedBlackTree<T, Hook, Compare>::closestLess(const T &key) const
+{
+    T *closestObject = nullptr;
+    T *currentObject = root;
+    while (currentObject != nullptr)
+    {
+        // Every object we step right from is less than the key and closer than the last one
+        if (compare(*currentObject, key))
+        {
+            closestObject = currentObject;
+            currentObject = hook(currentObject).right;
+        }
+        else
+        {
+            currentObject = hook(currentObject).left;
+        }
+    }
+    return closestObject;
+}
+
+// Returns the smallest linked object that is greater than the key, or nullptr if there is none
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+T *IntrusiveRedBlackTree<T, Hook, Compare>::closestGreater(const T &key) const
+{
+    T *closestObject = nullptr;
+    T *currentObject = root;
+    while (currentObject != nullptr)
+    {
+        if (compare(key, *currentObject))
+        {
+            closestObject = currentObject;
+            currentObject = hook(currentObject).left;
+        }
+        else
+        {
+            currentObject = hook(currentObject).right;
+        }
+    }
+    return closestObject;
+}
+
+// Returns all of the linked objects in ascending order
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+vector<T *> IntrusiveRedBlackTree<T, Hook, Compare>::values() const
+{
+    vector<T *> treeObjects;
+    treeObjects.reserve(treeSize);
+    inOrderObjects(root, treeObjects);
+    return treeObjects;
+}
+
+// Appends the objects of the subtree to treeObjects in ascending order
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+void IntrusiveRedBlackTree<T, Hook, Compare>::inOrderObjects(T *currentObject, vector<T *> &treeObjects) const
+{
+    if (currentObject == nullptr)
+    {
+        return;
+    }
+    inOrderObjects(hook(currentObject).left, treeObjects);
+    treeObjects.push_back(currentObject);
+    inOrderObjects(hook(currentObject).right, treeObjects);
+}
+
+// Returns the number of linked objects
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+int IntrusiveRedBlackTree<T, Hook, Compare>::size() const
+{
+    return treeSize;
+}
+
+// Unlinks every object without touching anything but their hooks
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+void IntrusiveRedBlackTree<T, Hook, Compare>::clear()
+{
+    unlinkTree(root);
+    root = nullptr;
+    treeSize = 0;
+}
+
+// Resets the hooks of every object in the subtree
+template <class T, RedBlackTreeHook<T> T::*Hook, class Compare>
+void IntrusiveRedBlackTree<T, Hook, Compare>::unlinkTree(T *currentObject)
+{
+    if (currentObject != nullptr)
+    {
+        unlinkTree(hook(currentObject).left);
+        unlinkTree(hook(currentObject).right);
+        hook(currentObject) = RedBlackTreeHook<T>();
+    }
+}
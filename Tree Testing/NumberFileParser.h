@@ -0,0 +1,470 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AsyncFileReader.h"
+#include "SpscQueue.h"
+#include "WorkStealingPool.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using std::string;
+using std::vector;
+
+// How statistics() reads its file
+enum class IngestMode
+{
+    Sequential, // One thread parses the whole file
+    Parallel,   // Newline-aligned chunks are parsed, sorted and deduplicated on the WorkStealingPool
+    Pipelined,  // One thread parses while the calling thread inserts what it has parsed so far
+    AsyncIO     // Blocks are read ahead with io_uring (or pread) and parsed as they arrive
+};
+
+// Returns true for the characters `stream >> value` skips before a number
+inline bool isNumberSeparator(char character)
+{
+    return character == ' ' || character == '\n' || character == '\t' || character == '\r' || character == '\v' || character == '\f';
+}
+
+// Appends the whitespace-separated numbers in [first, last) to numbers using std::from_chars,
+// which parses straight from the buffer without locales, streams or copies
+// Stops at the first token that does not start with a number, like a loop of `stream >> value`,
+// and returns where parsing stopped
+inline const char *parseNumbers(const char *first, const char *last, vector<double> &numbers)
+{
+    const char *position = first;
+    while (true)
+    {
+        while (position != last && isNumberSeparator(*position))
+        {
+            position++;
+        }
+        if (position == last)
+        {
+            return position;
+        }
+
+        // from_chars takes no leading '+' and accepts "inf" and "nan", which streams treat the other way round
+        const char *numberStart = position;
+        if (*numberStart == '+' && numberStart + 1 != last && numberStart[1] != '-')
+        {
+            numberStart++;
+        }
+        const char *digitStart = (*numberStart == '-' && numberStart + 1 != last) ? numberStart + 1 : numberStart;
+        if (!(*digitStart >= '0' && *digitStart <= '9') && *digitStart != '.')
+        {
+            return position;
+        }
+
+        double number = 0.0;
+        std::from_chars_result result = std::from_chars(numberStart, last, number);
+        if (result.ec != std::errc())
+        {
+            return position;
+        }
+        numbers.push_back(number);
+        position = result.ptr;
+    }
+}
+
+// Read-only view of a whole file
+// The file is memory-mapped where the platform allows it, so it is parsed in place without being copied;
+// otherwise it is read into one buffer
+class MappedFile
+{
+    // Private attributes
+private:
+    const char *contents;
+    size_t contentSize;
+    bool opened;
+    bool mapped;
+    string buffer; // Holds the file when it could not be mapped
+
+    // Public methods
+public:
+    explicit MappedFile(const string &filename);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+    bool isOpen() const;
+    const char *begin() const;
+    const char *end() const;
+    size_t size() const;
+};
+
+// Constructor
+// Opens and maps the file; isOpen() reports whether that worked
+inline MappedFile::MappedFile(const string &filename) : contents(nullptr), contentSize(0), opened(false), mapped(false)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    int fileDescriptor = open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor == -1)
+    {
+        return;
+    }
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode))
+    {
+        size_t fileSize = fileStatus.st_size;
+        void *mapping = fileSize == 0 ? MAP_FAILED : mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (fileSize == 0 || mapping != MAP_FAILED)
+        {
+            if (mapping != MAP_FAILED)
+            {
+                madvise(mapping, fileSize, MADV_SEQUENTIAL);
+                contents = static_cast<const char *>(mapping);
+                contentSize = fileSize;
+                mapped = true;
+            }
+            close(fileDescriptor);
+            opened = true;
+            return;
+        }
+    }
+    close(fileDescriptor);
+#endif
+
+    // Fall back to reading the whole file into one buffer
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        return;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    contents = buffer.data();
+    contentSize = buffer.size();
+    opened = true;
+}
+
+// Destructor
+inline MappedFile::~MappedFile()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapped)
+    {
+        munmap(const_cast<char *>(contents), contentSize);
+    }
+#endif
+}
+
+// Returns true if the file could be opened
+inline bool MappedFile::isOpen() const
+{
+    return opened;
+}
+
+// Returns the first byte of the file
+inline const char *MappedFile::begin() const
+{
+    return contents;
+}
+
+// Returns one past the last byte of the file
+inline const char *MappedFile::end() const
+{
+    return contents + contentSize;
+}
+
+// Returns the size of the file in bytes
+inline size_t MappedFile::size() const
+{
+    return contentSize;
+}
+
+// Reads every number in the file into numbers, stopping at the first token that is not a number
+// Returns false if the file cannot be opened
+inline bool readNumberFile(const string &filename, vector<double> &numbers)
+{
+    MappedFile file(filename);
+    if (!file.isOpen())
+    {
+        return false;
+    }
+    parseNumbers(file.begin(), file.end(), numbers);
+    return true;
+}
+
+// One newline-aligned piece of a file and the sorted numbers parsed from it
+struct NumberChunk
+{
+    const char *first = nullptr;
+    const char *last = nullptr;
+    bool stoppedEarly = false; // A token that is not a number ended parsing before last
+    vector<double> numbers;
+};
+
+// Parses and sorts chunks[first, last), splitting the range across the pool; repeats are removed unless keepRepeats is set
+inline void parseChunks(vector<NumberChunk> &chunks, size_t first, size_t last, bool keepRepeats, WorkStealingPool &pool)
+{
+    if (last - first == 1)
+    {
+        NumberChunk &chunk = chunks[first];
+        chunk.stoppedEarly = parseNumbers(chunk.first, chunk.last, chunk.numbers) != chunk.last;
+        std::sort(chunk.numbers.begin(), chunk.numbers.end());
+        if (!keepRepeats)
+        {
+            chunk.numbers.erase(std::unique(chunk.numbers.begin(), chunk.numbers.end()), chunk.numbers.end());
+        }
+        return;
+    }
+    size_t middle = first + (last - first) / 2;
+    pool.invoke([&]()
+                { parseChunks(chunks, first, middle, keepRepeats, pool); },
+                [&]()
+                { parseChunks(chunks, middle, last, keepRepeats, pool); });
+}
+
+// Merges the sorted numbers of chunks[first, last) into one sorted vector, keeping repeats across chunks only if
+// keepRepeats is set; halves are merged in parallel
+inline vector<double> mergeChunks(vector<NumberChunk> &chunks, size_t first, size_t last, bool keepRepeats, WorkStealingPool &pool)
+{
+    if (last - first == 1)
+    {
+        return std::move(chunks[first].numbers);
+    }
+    size_t middle = first + (last - first) / 2;
+    vector<double> lowerNumbers, higherNumbers;
+    pool.invoke([&]()
+                { lowerNumbers = mergeChunks(chunks, first, middle, keepRepeats, pool); },
+                [&]()
+                { higherNumbers = mergeChunks(chunks, middle, last, keepRepeats, pool); });
+    vector<double> mergedNumbers;
+    mergedNumbers.reserve(lowerNumbers.size() + higherNumbers.size());
+    if (keepRepeats)
+    {
+        std::merge(lowerNumbers.begin(), lowerNumbers.end(), higherNumbers.begin(), higherNumbers.end(),
+                   std::back_inserter(mergedNumbers));
+    }
+    else
+    {
+        std::set_union(lowerNumbers.begin(), lowerNumbers.end(), higherNumbers.begin(), higherNumbers.end(),
+                       std::back_inserter(mergedNumbers));
+    }
+    return mergedNumbers;
+}
+
+// Appends the numbers in the file to numbers, sorted, using every worker of the pool; repeats are kept only if
+// keepRepeats is set (see readNumberFileParallel and readAllNumbersParallel)
+inline bool readSortedNumbersParallel(const string &filename, vector<double> &numbers, bool keepRepeats, WorkStealingPool &pool)
+{
+    const size_t minimumChunkSize = 1 << 20;
+    MappedFile file(filename);
+    if (!file.isOpen())
+    {
+        return false;
+    }
+
+    // Aim for a few chunks per worker so that a slow chunk does not hold the others up
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(file.size() / minimumChunkSize, pool.threadCount() * 4));
+    vector<NumberChunk> chunks;
+    const char *chunkStart = file.begin();
+    for (size_t i = 1; i <= chunkCount && chunkStart != file.end(); i++)
+    {
+        const char *chunkEnd = i == chunkCount ? file.end() : std::max(chunkStart, file.begin() + file.size() / chunkCount * i);
+        while (chunkEnd != file.end() && !isNumberSeparator(*chunkEnd))
+        {
+            chunkEnd++;
+        }
+        chunks.emplace_back();
+        chunks.back().first = chunkStart;
+        chunks.back().last = chunkEnd;
+        chunkStart = chunkEnd;
+    }
+    if (chunks.empty())
+    {
+        return true;
+    }
+    parseChunks(chunks, 0, chunks.size(), keepRepeats, pool);
+
+    // Chunks after one that hit an invalid token would not have been read by a sequential parse
+    size_t usedChunks = 0;
+    while (usedChunks < chunks.size() && !chunks[usedChunks++].stoppedEarly)
+    {
+    }
+    vector<double> fileNumbers = mergeChunks(chunks, 0, usedChunks, keepRepeats, pool);
+    if (numbers.empty())
+    {
+        numbers = std::move(fileNumbers);
+    }
+    else
+    {
+        numbers.insert(numbers.end(), fileNumbers.begin(), fileNumbers.end());
+    }
+    return true;
+}
+
+// Appends the numbers in the file to numbers, sorted and without duplicates, using every worker of the pool
+// The file is split into chunks that start after a separator, so no number is cut in two; each chunk is parsed,
+// sorted and deduplicated on its own worker, and the chunks are then merged pairwise in parallel.
+// As with readNumberFile, nothing after the first token that is not a number is read
+// Returns false if the file cannot be opened
+inline bool readNumberFileParallel(const string &filename, vector<double> &numbers, WorkStealingPool &pool = WorkStealingPool::global())
+{
+    return readSortedNumbersParallel(filename, numbers, false, pool);
+}
+
+// Like readNumberFileParallel, but every number is kept, repeats included
+inline bool readAllNumbersParallel(const string &filename, vector<double> &numbers, WorkStealingPool &pool = WorkStealingPool::global())
+{
+    return readSortedNumbersParallel(filename, numbers, true, pool);
+}
+
+// Parses the file on a separate thread and passes its numbers to consumeBatch on the calling thread,
+// in file order, a batch at a time
+// The parser and the caller are connected by an SpscQueue of batches, so reading and parsing the next
+// batch overlaps with whatever consumeBatch does with the last one.
+// As with readNumberFile, nothing after the first token that is not a number is read
+// If consumeBatch throws, the parser is stopped and joined and the exception is passed on
+// Returns false if the file cannot be opened
+template <class Consumer>
+bool readNumberFilePipelined(const string &filename, Consumer consumeBatch)
+{
+    const size_t batchBytes = 1 << 16;
+    MappedFile file(filename);
+    if (!file.isOpen())
+    {
+        return false;
+    }
+
+    SpscQueue<vector<double>> batches(16);
+    std::atomic<bool> stopRequested{false}; // Set when consumeBatch throws, so the parser gives up
+    std::exception_ptr parserError;
+
+    // Returns false instead of waiting on a full queue once the consumer has given up
+    auto offerBatch = [&](vector<double> &batch)
+    {
+        while (!batches.tryPush(batch))
+        {
+            if (stopRequested.load())
+            {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    };
+    std::thread parser([&]()
+                       {
+                           try
+                           {
+                               const char *batchStart = file.begin();
+                               bool stoppedEarly = false;
+                               while (batchStart != file.end() && !stoppedEarly)
+                               {
+                                   const char *batchEnd = batchStart + std::min<size_t>(batchBytes, file.end() - batchStart);
+                                   while (batchEnd != file.end() && !isNumberSeparator(*batchEnd))
+                                   {
+                                       batchEnd++;
+                                   }
+                                   vector<double> batch;
+                                   stoppedEarly = parseNumbers(batchStart, batchEnd, batch) != batchEnd;
+                                   if (!batch.empty() && !offerBatch(batch))
+                                   {
+                                       return;
+                                   }
+                                   batchStart = batchEnd;
+                               }
+                           }
+                           catch (...)
+                           {
+                               parserError = std::current_exception();
+                           }
+
+                           // An empty batch marks the end of the file
+                           vector<double> endMarker;
+                           offerBatch(endMarker); });
+
+    // If consumeBatch throws, stop the parser and wait for it before passing the exception on,
+    // since the thread must be joined before it is destroyed
+    try
+    {
+        while (true)
+        {
+            vector<double> batch = batches.pop();
+            if (batch.empty())
+            {
+                break;
+            }
+            consumeBatch(batch);
+        }
+    }
+    catch (...)
+    {
+        stopRequested = true;
+        parser.join();
+        throw;
+    }
+    parser.join();
+    if (parserError)
+    {
+        std::rethrow_exception(parserError);
+    }
+    return true;
+}
+
+// Appends the numbers in the file to numbers, parsing each block as soon as the reader delivers it, and calls
+// consumeNumbers(numbers) after each block; it may take the numbers out, so that memory stays bounded by the
+// reader's blocks however large the file is
+// A number cut in two at the end of a block is kept back and completed with the start of the next block.
+// As with readNumberFile, nothing after the first token that is not a number is read
+// Returns false if the file cannot be opened or read
+template <class NumbersConsumer>
+bool readNumberBlocks(const string &filename, vector<double> &numbers, AsyncFileReader &reader, NumbersConsumer consumeNumbers)
+{
+    string unfinishedToken; // Bytes since the last separator of the previous blocks
+    bool stoppedEarly = false;
+    bool succeeded = reader.read(filename, [&](const char *first, const char *last)
+                                 {
+                                     const char *firstSeparator = std::find_if(first, last, isNumberSeparator);
+                                     unfinishedToken.append(first, firstSeparator);
+                                     if (firstSeparator == last)
+                                     {
+                                         return true;
+                                     }
+                                     const char *unfinishedEnd = unfinishedToken.data() + unfinishedToken.size();
+                                     if (parseNumbers(unfinishedToken.data(), unfinishedEnd, numbers) != unfinishedEnd)
+                                     {
+                                         stoppedEarly = true;
+                                         return false;
+                                     }
+
+                                     // Everything up to the last separator holds whole numbers
+                                     const char *lastSeparator = last - 1;
+                                     while (!isNumberSeparator(*lastSeparator))
+                                     {
+                                         lastSeparator--;
+                                     }
+                                     stoppedEarly = parseNumbers(firstSeparator, lastSeparator + 1, numbers) != lastSeparator + 1;
+                                     consumeNumbers(numbers);
+                                     unfinishedToken.assign(lastSeparator + 1, last);
+                                     return !stoppedEarly; });
+    if (succeeded && !stoppedEarly)
+    {
+        parseNumbers(unfinishedToken.data(), unfinishedToken.data() + unfinishedToken.size(), numbers);
+    }
+    consumeNumbers(numbers);
+    return succeeded;
+}
+
+// Appends the numbers in the file to numbers, reading it block by block with the given reader
+// Returns false if the file cannot be opened or read
+inline bool readNumberFileAsync(const string &filename, vector<double> &numbers, AsyncFileReader &reader)
+{
+    return readNumberBlocks(filename, numbers, reader, [](vector<double> &) {});
+}
+
+// Appends the numbers in the file to numbers, reading it with a default AsyncFileReader
+inline bool readNumberFileAsync(const string &filename, vector<double> &numbers)
+{
+    AsyncFileReader reader;
+    return readNumberFileAsync(filename, numbers, reader);
+}
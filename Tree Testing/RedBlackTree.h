@@ -3,15 +3,128 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <utility>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "WorkStealingPool.h"
+#include "BackgroundReclaimer.h"
 using std::cout;
 using std::endl;
 using std::ifstream;
 using std::string;
 using std::vector;
 
+// Memory order used by RedBlackTree::compact when it relays out the nodes
+enum class NodeLayout
+{
+    InOrder,    // Nodes are stored in ascending value order, which suits values() and range scans
+    VanEmdeBoas // Recursive top/bottom subtree blocks, which suits root-to-leaf descents
+};
+
+// Count, mean and spread of a set of numbers
+// Summaries of two disjoint sets merge exactly (the pairwise update of Chan, Golub and LeVeque),
+// which keeps the spread accurate where a running sum of squares would cancel out
+struct ValueSummary
+{
+    long long count = 0;
+    double sum = 0.0;
+    double squaredDeviations = 0.0; // Sum of the squared differences from the mean
+
+    void add(double value);
+    void merge(const ValueSummary &other);
+    double mean() const;
+    double variance() const;
+    double sampleVariance() const;
+    double standardDeviation() const;
+};
+
+// Adds one number
+inline void ValueSummary::add(double value)
+{
+    ValueSummary single;
+    single.count = 1;
+    single.sum = value;
+    merge(single);
+}
+
+// Adds every number of a disjoint set
+inline void ValueSummary::merge(const ValueSummary &other)
+{
+    if (other.count == 0)
+    {
+        return;
+    }
+    if (count == 0)
+    {
+        *this = other;
+        return;
+    }
+    double delta = other.sum / other.count - sum / count;
+    squaredDeviations += other.squaredDeviations + delta * delta * ((double)count * other.count / (count + other.count));
+    count += other.count;
+    sum += other.sum;
+}
+
+// Returns the average, or 0 for an empty set
+inline double ValueSummary::mean() const
+{
+    return count == 0 ? 0.0 : sum / count;
+}
+
+// Returns the population variance, or 0 for an empty set
+inline double ValueSummary::variance() const
+{
+    return count == 0 ? 0.0 : squaredDeviations / count;
+}
+
+// Returns the sample variance (divided by count - 1), or 0 for fewer than two numbers
+inline double ValueSummary::sampleVariance() const
+{
+    return count < 2 ? 0.0 : squaredDeviations / (count - 1);
+}
+
+// Returns the population standard deviation, or 0 for an empty set
+inline double ValueSummary::standardDeviation() const
+{
+    return std::sqrt(variance());
+}
+
+// Which number a tree value contributes to a ValueSummary: numbers stand for themselves, and pairs
+// (such as the (value, sequence number) keys that let a tree hold repeated values) for their first member
+template <class T>
+struct SummaryValue
+{
+    static constexpr bool isSummarised = std::is_arithmetic<T>::value;
+    static double of(const T &value) { return (double)value; }
+};
+
+template <class First, class Second>
+struct SummaryValue<std::pair<First, Second>>
+{
+    static constexpr bool isSummarised = std::is_arithmetic<First>::value;
+    static double of(const std::pair<First, Second> &value) { return (double)value.first; }
+};
+
+// Fields a node carries when its tree's values are summarised; empty otherwise
+template <class T, bool = SummaryValue<T>::isSummarised>
+struct NodeSummaryFields
+{
+};
+
+template <class T>
+struct NodeSummaryFields<T, true>
+{
+    double subtreeSum = 0.0;               // Of the values in the subtree rooted here
+    double subtreeSquaredDeviations = 0.0; // Of those values from their mean
+};
+
 // NodeT class
 template <class T>
-class NodeT
+class NodeT : public NodeSummaryFields<T>
 {
 public:
     T data;
@@ -19,25 +132,66 @@ public:
     NodeT<T> *right;
     NodeT<T> *parent;
     bool isBlack;
+    int subtreeSize; // Number of nodes in the subtree rooted here, including this one
 
     // NodeT Constructor
-    NodeT<T>(T value) : data(value), left(nullptr), right(nullptr), parent(nullptr), isBlack(false){};
+    NodeT(T value) : data(std::move(value)), left(nullptr), right(nullptr), parent(nullptr), isBlack(false), subtreeSize(1)
+    {
+        if constexpr (SummaryValue<T>::isSummarised)
+        {
+            this->subtreeSum = SummaryValue<T>::of(data);
+        }
+    };
 };
 
-template <class T>
+// Nodes are allocated through a rebound copy of Allocator, so a tree can draw its memory
+// from a pool, a per-request arena or any other std::pmr::memory_resource
+template <class T, class Allocator = std::allocator<T>>
 class RedBlackTree
 {
     // Private attributes and helper methods
 private:
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<NodeT<T>>;
+    using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+    NodeAllocator nodeAllocator;
     NodeT<T> *root;
     int treeSize;
+    NodeT<T> *nodeArena;   // Contiguous block of nodes created by compact, nullptr if there is none
+    int arenaCapacity;     // Number of nodes the arena was created with
+    int arenaNodesInUse;   // Arena nodes that are still part of the tree
+    bool backgroundReclamation; // Hand teardown to BackgroundReclaimer::global() instead of freeing nodes in place
+
+    // Allocators are not required to be thread-safe, so nodes are only created and freed on
+    // several threads at once when they come from std::allocator
+    static constexpr bool allocatorIsThreadSafe = std::is_same<Allocator, std::allocator<T>>::value;
+    NodeT<T> *createNode(const T value);
+    void destroyNode(NodeT<T> *nodeToDestroy);
+    bool deallocationIsNoOp() const;
+    int height(const NodeT<T> *currentNode) const;
+    void vanEmdeBoasOrder(NodeT<T> *currentNode, int levels, vector<NodeT<T> *> &layoutOrder) const;
+    void nodesAtDepth(NodeT<T> *currentNode, int depth, vector<NodeT<T> *> &depthNodes) const;
+    void inOrderNodes(NodeT<T> *currentNode, vector<NodeT<T> *> &layoutOrder) const;
+    static int sizeOf(const NodeT<T> *currentNode);
+    static ValueSummary summaryOf(const NodeT<T> *currentNode);
+    static void updateSummary(NodeT<T> *currentNode);
+    static void copySummary(NodeT<T> *targetNode, const NodeT<T> *sourceNode);
+    static int countLess(const NodeT<T> *currentNode, const T &valueToCompare);
+    static int countGreater(const NodeT<T> *currentNode, const T &valueToCompare);
+    static void exportSubtree(const NodeT<T> *currentNode, T *output, WorkStealingPool &pool);
+    static void exportAtLeast(const NodeT<T> *currentNode, const T &lowerValue, T *output, WorkStealingPool &pool);
+    static void exportAtMost(const NodeT<T> *currentNode, const T &higherValue, T *output, WorkStealingPool &pool);
+    NodeT<T> *buildSubtree(const vector<T> &sortedValues, NodeT<T> *const *nodeStorage, size_t first, size_t last,
+                           int depth, int redDepth, WorkStealingPool *pool);
     NodeT<T> *copyTree(const NodeT<T> *treeNode);
     bool isEmpty() const;
     NodeT<T> *findNode(const T valueToSearch) const;
     void deleteTree(NodeT<T> *treeNode);
-    vector<T> inOrderValues(const NodeT<T> *currentNode, vector<T> &treeValues) const;
-    vector<T> rangeSearch(const NodeT<T> *currentNode, const T valueToSearch1,
-                          const T valueToSearch2, vector<T> &treeValues) const;
+    void releaseTree();
+    static void reclaimDetached(NodeAllocator &allocator, NodeT<T> *treeNode, const NodeT<T> *arena, int capacity);
+    void inOrderValues(const NodeT<T> *currentNode, vector<T> &treeValues) const;
+    void rangeSearch(const NodeT<T> *currentNode, const T valueToSearch1,
+                     const T valueToSearch2, vector<T> &treeValues) const;
     void rotateLeft(NodeT<T> *nodeToRotate);
     void rotateRight(NodeT<T> *nodeToRotate);
     NodeT<T> *BSTInsert(NodeT<T> *currentNode, NodeT<T> *nodeToStore);
@@ -48,8 +202,9 @@ private:
     // Public methods
 public:
     RedBlackTree();
-    RedBlackTree(const RedBlackTree<T> &treeParameter);
-    RedBlackTree<T> &operator=(const RedBlackTree<T> &treeParameter);
+    explicit RedBlackTree(const Allocator &allocator);
+    RedBlackTree(const RedBlackTree<T, Allocator> &treeParameter);
+    RedBlackTree<T, Allocator> &operator=(const RedBlackTree<T, Allocator> &treeParameter);
     ~RedBlackTree();
     bool insert(const T valueToStore);
     bool remove(const T valueToRemove);
@@ -59,38 +214,80 @@ public:
     T closestGreater(const T valueToCompare) const;
     vector<T> values() const;
     int size() const;
+    T select(int index) const;
+    int rank(const T valueToCompare) const;
+    ValueSummary summary() const;
+    ValueSummary summary(const T valueToSearch1, const T valueToSearch2) const;
+    void compact(NodeLayout layout = NodeLayout::InOrder);
+    void buildParallel(vector<T> valuesToStore, WorkStealingPool &pool = WorkStealingPool::global());
+    vector<T> valuesParallel(WorkStealingPool &pool = WorkStealingPool::global()) const;
+    vector<T> searchParallel(const T valueToSearch1, const T valueToSearch2, WorkStealingPool &pool = WorkStealingPool::global()) const;
+    void setBackgroundReclamation(bool enabled);
+    Allocator getAllocator() const;
     template <class Tjwme>
     friend NodeT<Tjwme> *getTreeRoot(const RedBlackTree<Tjwme> &rbt);
 };
 
-// Constructor
+// RedBlackTree whose nodes come from a std::pmr::memory_resource
+// A tree built on a std::pmr::monotonic_buffer_resource skips the node-by-node teardown entirely
 template <class T>
-RedBlackTree<T>::RedBlackTree()
+using PmrRedBlackTree = RedBlackTree<T, std::pmr::polymorphic_allocator<T>>;
+
+// Constructor
+template <class T, class Allocator>
+RedBlackTree<T, Allocator>::RedBlackTree()
 {
     // Create an empty tree
     root = nullptr;
     treeSize = 0;
+    nodeArena = nullptr;
+    arenaCapacity = 0;
+    arenaNodesInUse = 0;
+    backgroundReclamation = false;
+}
+
+// Constructor that allocates nodes through the given allocator
+template <class T, class Allocator>
+RedBlackTree<T, Allocator>::RedBlackTree(const Allocator &allocator) : nodeAllocator(allocator)
+{
+    // Create an empty tree
+    root = nullptr;
+    treeSize = 0;
+    nodeArena = nullptr;
+    arenaCapacity = 0;
+    arenaNodesInUse = 0;
+    backgroundReclamation = false;
 }
 
 // Copy constructor
-template <class T>
-RedBlackTree<T>::RedBlackTree(const RedBlackTree<T> &treeParameter)
+template <class T, class Allocator>
+RedBlackTree<T, Allocator>::RedBlackTree(const RedBlackTree<T, Allocator> &treeParameter)
+    : nodeAllocator(NodeAllocatorTraits::select_on_container_copy_construction(treeParameter.nodeAllocator))
 {
     // Deep copies its constant RedBlackTree reference parameter
+    nodeArena = nullptr;
+    arenaCapacity = 0;
+    arenaNodesInUse = 0;
+    backgroundReclamation = false;
     root = copyTree(treeParameter.root);
     treeSize = treeParameter.treeSize;
 }
 
 // Overloads the assignment operator for RedBlackTree
-template <class T>
-RedBlackTree<T> &RedBlackTree<T>::operator=(const RedBlackTree<T> &treeParameter)
+template <class T, class Allocator>
+RedBlackTree<T, Allocator> &RedBlackTree<T, Allocator>::operator=(const RedBlackTree<T, Allocator> &treeParameter)
 {
     // If the calling object is the parameter, the operator should not copy it
     if (this != &treeParameter)
     {
         // Dallocates dynamic memory associated with the original tree
-        deleteTree(root);
-        root = nullptr;
+        releaseTree();
+
+        // Only allocators that ask for it follow the assigned tree
+        if constexpr (NodeAllocatorTraits::propagate_on_container_copy_assignment::value)
+        {
+            nodeAllocator = treeParameter.nodeAllocator;
+        }
 
         // Deep copies its constant QueueT reference parameter
         root = copyTree(treeParameter.root);
@@ -102,9 +299,10 @@ RedBlackTree<T> &RedBlackTree<T>::operator=(const RedBlackTree<T> &treeParameter
 
 // Helper function to create a copy of the parameter
 // onto the calling object tree
-template <class T>
-NodeT<T> *RedBlackTree<T>::copyTree(const NodeT<T> *treeNode)
+template <class T, class Allocator>
+NodeT<T> *RedBlackTree<T, Allocator>::copyTree(const NodeT<T> *treeNode)
 {
+    const int parallelCutoff = 1 << 14;
     if (treeNode == nullptr)
     {
         return nullptr;
@@ -112,20 +310,30 @@ NodeT<T> *RedBlackTree<T>::copyTree(const NodeT<T> *treeNode)
     else
     {
         // Create a new node with the original properties
-        NodeT<T> *newNode = new NodeT<T>(treeNode->data);
+        NodeT<T> *newNode = createNode(treeNode->data);
         newNode->isBlack = treeNode->isBlack;
+        newNode->subtreeSize = treeNode->subtreeSize;
+        copySummary(newNode, treeNode);
 
-        // Copy nodes in the left subtree
-        newNode->left = copyTree(treeNode->left);
+        // Copy nodes in the left and right subtrees, side by side for large subtrees
+        if (allocatorIsThreadSafe && treeNode->subtreeSize > parallelCutoff)
+        {
+            WorkStealingPool::global().invoke([&]()
+                                              { newNode->left = copyTree(treeNode->left); },
+                                              [&]()
+                                              { newNode->right = copyTree(treeNode->right); });
+        }
+        else
+        {
+            newNode->left = copyTree(treeNode->left);
+            newNode->right = copyTree(treeNode->right);
+        }
 
         // Assign parent pointers
         if (newNode->left != nullptr)
         {
             newNode->left->parent = newNode;
         }
-
-        // Copy nodes in the right subtree
-        newNode->right = copyTree(treeNode->right);
         if (newNode->right != nullptr)
         {
             newNode->right->parent = newNode;
@@ -136,39 +344,158 @@ NodeT<T> *RedBlackTree<T>::copyTree(const NodeT<T> *treeNode)
 }
 
 // Destructor
-template <class T>
-RedBlackTree<T>::~RedBlackTree()
+template <class T, class Allocator>
+RedBlackTree<T, Allocator>::~RedBlackTree()
 {
-    deleteTree(root);
-    root = nullptr;
+    releaseTree();
     treeSize = 0;
 }
 
 // Helper Function for Destroying tree
 // Deallocates dynamic memory allocated by the tree
-template <class T>
-void RedBlackTree<T>::deleteTree(NodeT<T> *treeNode)
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::deleteTree(NodeT<T> *treeNode)
 {
+    const int parallelCutoff = 1 << 14;
     if (treeNode != nullptr)
     {
-        // Destroy the left and right subtrees
-        deleteTree(treeNode->left);
-        deleteTree(treeNode->right);
-        delete treeNode;
+        // Destroy the left and right subtrees, side by side for large subtrees
+        // (arena nodes update shared bookkeeping when destroyed, so those stay on one thread)
+        if (allocatorIsThreadSafe && nodeArena == nullptr && treeNode->subtreeSize > parallelCutoff)
+        {
+            WorkStealingPool::global().invoke([&]()
+                                              { deleteTree(treeNode->left); },
+                                              [&]()
+                                              { deleteTree(treeNode->right); });
+        }
+        else
+        {
+            deleteTree(treeNode->left);
+            deleteTree(treeNode->right);
+        }
+        destroyNode(treeNode);
         treeNode = nullptr;
     }
 }
 
+// Frees every node of the tree and leaves it empty
+// With background reclamation the nodes (and any arena) are handed to the reclaimer thread,
+// so this returns at once
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::releaseTree()
+{
+    if (root != nullptr && backgroundReclamation)
+    {
+        NodeAllocator allocator = nodeAllocator;
+        NodeT<T> *detachedRoot = root;
+        NodeT<T> *arena = nodeArena;
+        int capacity = arenaCapacity;
+        BackgroundReclaimer::global().submit([allocator, detachedRoot, arena, capacity]() mutable
+                                             {
+            reclaimDetached(allocator, detachedRoot, arena, capacity);
+            if (arena != nullptr)
+            {
+                NodeAllocatorTraits::deallocate(allocator, arena, capacity);
+            } });
+        nodeArena = nullptr;
+        arenaCapacity = 0;
+        arenaNodesInUse = 0;
+    }
+    // Memory from a monotonic buffer is only reclaimed when the buffer itself is released,
+    // so walking the tree to free each node would achieve nothing
+    else if (!deallocationIsNoOp())
+    {
+        deleteTree(root);
+    }
+    root = nullptr;
+}
+
+// Frees the nodes of a subtree that no tree refers to any more
+// Nodes inside the arena are only destroyed; the caller releases the arena block itself
+// Runs on the reclaimer thread, so it only touches what it is given
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::reclaimDetached(NodeAllocator &allocator, NodeT<T> *treeNode, const NodeT<T> *arena, int capacity)
+{
+    if (treeNode != nullptr)
+    {
+        reclaimDetached(allocator, treeNode->left, arena, capacity);
+        reclaimDetached(allocator, treeNode->right, arena, capacity);
+        NodeAllocatorTraits::destroy(allocator, treeNode);
+        if (arena == nullptr || treeNode < arena || treeNode >= arena + capacity)
+        {
+            NodeAllocatorTraits::deallocate(allocator, treeNode, 1);
+        }
+    }
+}
+
+// Chooses whether operator= and the destructor free the old nodes in place (the default)
+// or hand them to the background reclaimer thread and return immediately
+// A stateful allocator's memory resource must outlive the reclaimer's work on it;
+// BackgroundReclaimer::global().drain() waits for that work to finish
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::setBackgroundReclamation(bool enabled)
+{
+    backgroundReclamation = enabled;
+}
+
+// Allocates a new red node holding the value parameter
+template <class T, class Allocator>
+NodeT<T> *RedBlackTree<T, Allocator>::createNode(const T value)
+{
+    NodeT<T> *newNode = NodeAllocatorTraits::allocate(nodeAllocator, 1);
+    NodeAllocatorTraits::construct(nodeAllocator, newNode, value);
+    return newNode;
+}
+
+// Deallocates a node that is no longer part of the tree
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::destroyNode(NodeT<T> *nodeToDestroy)
+{
+    // Nodes inside the arena are destroyed in place; the block itself is
+    // released once the last of its nodes has left the tree
+    if (nodeArena != nullptr && nodeToDestroy >= nodeArena && nodeToDestroy < nodeArena + arenaCapacity)
+    {
+        NodeAllocatorTraits::destroy(nodeAllocator, nodeToDestroy);
+        arenaNodesInUse--;
+        if (arenaNodesInUse == 0)
+        {
+            NodeAllocatorTraits::deallocate(nodeAllocator, nodeArena, arenaCapacity);
+            nodeArena = nullptr;
+            arenaCapacity = 0;
+        }
+    }
+    else
+    {
+        NodeAllocatorTraits::destroy(nodeAllocator, nodeToDestroy);
+        NodeAllocatorTraits::deallocate(nodeAllocator, nodeToDestroy, 1);
+    }
+}
+
+// Returns true if freeing the nodes one by one has no effect,
+// which is the case for trivially destructible values in a monotonic buffer
+template <class T, class Allocator>
+bool RedBlackTree<T, Allocator>::deallocationIsNoOp() const
+{
+    if constexpr (std::is_same<Allocator, std::pmr::polymorphic_allocator<T>>::value && std::is_trivially_destructible<T>::value)
+    {
+        return dynamic_cast<std::pmr::monotonic_buffer_resource *>(nodeAllocator.resource()) != nullptr;
+    }
+    else
+    {
+        return false;
+    }
+}
+
 // Inserts the value parameter into the Red-Black tree
 // Returns true on success or false if the node is already present
-template <class T>
-bool RedBlackTree<T>::insert(const T valueToStore)
+template <class T, class Allocator>
+bool RedBlackTree<T, Allocator>::insert(const T valueToStore)
 {
     // If the value is already in the tree, return false
     if (search(valueToStore) == false)
     {
         // If the value is not present, create a new node
-        NodeT<T> *nodeToStore = new NodeT<T>(valueToStore);
+        NodeT<T> *nodeToStore = createNode(valueToStore);
 
         // Insert the node normally and "fix" it for the Red-Black Tree
         root = BSTInsert(root, nodeToStore);
@@ -180,8 +507,8 @@ bool RedBlackTree<T>::insert(const T valueToStore)
 }
 
 // Fixes the Red-Black Tree after the insertion of a node
-template <class T>
-void RedBlackTree<T>::RBInsert(NodeT<T> *nodeToStore)
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::RBInsert(NodeT<T> *nodeToStore)
 {
     // Continue looping if the node or its parent is red, or until the root isn't reached
     while (nodeToStore != root && nodeToStore->isBlack == false && nodeToStore->parent->isBlack == false)
@@ -254,8 +581,8 @@ void RedBlackTree<T>::RBInsert(NodeT<T> *nodeToStore)
 }
 
 // Recursively finds the appropriate place to insert the nodeToStore parameter
-template <class T>
-NodeT<T> *RedBlackTree<T>::BSTInsert(NodeT<T> *currentNode, NodeT<T> *nodeToStore)
+template <class T, class Allocator>
+NodeT<T> *RedBlackTree<T, Allocator>::BSTInsert(NodeT<T> *currentNode, NodeT<T> *nodeToStore)
 {
     // We have found the place to insert the node
     if (currentNode == nullptr)
@@ -268,6 +595,8 @@ NodeT<T> *RedBlackTree<T>::BSTInsert(NodeT<T> *currentNode, NodeT<T> *nodeToStor
     {
         currentNode->left = BSTInsert(currentNode->left, nodeToStore);
         currentNode->left->parent = currentNode;
+        currentNode->subtreeSize++;
+        updateSummary(currentNode);
     }
 
     // If the parameter value is greater than the current node, search the right subtree
@@ -275,14 +604,16 @@ NodeT<T> *RedBlackTree<T>::BSTInsert(NodeT<T> *currentNode, NodeT<T> *nodeToStor
     {
         currentNode->right = BSTInsert(currentNode->right, nodeToStore);
         currentNode->right->parent = currentNode;
+        currentNode->subtreeSize++;
+        updateSummary(currentNode);
     }
 
     return currentNode;
 }
 
 // Finds the predecessor of the given node parameter
-template <class T>
-NodeT<T> *RedBlackTree<T>::predecessor(NodeT<T> *currentNode)
+template <class T, class Allocator>
+NodeT<T> *RedBlackTree<T, Allocator>::predecessor(NodeT<T> *currentNode)
 {
     NodeT<T> *nodePredecessor = currentNode;
 
@@ -298,8 +629,8 @@ NodeT<T> *RedBlackTree<T>::predecessor(NodeT<T> *currentNode)
 
 // Removes the value parameter from the Red-Black tree
 // Returns true on success or false if the node is not present
-template <class T>
-bool RedBlackTree<T>::remove(const T valueToRemove)
+template <class T, class Allocator>
+bool RedBlackTree<T, Allocator>::remove(const T valueToRemove)
 {
     if (search(valueToRemove))
     {
@@ -372,12 +703,19 @@ bool RedBlackTree<T>::remove(const T valueToRemove)
                 nodeToRemove->data = nodeToReplace->data;
             }
 
+            // Every ancestor of the unlinked node has lost one descendant, and nodeToRemove is among them
+            for (NodeT<T> *ancestor = nodeToReplace->parent; ancestor != nullptr; ancestor = ancestor->parent)
+            {
+                ancestor->subtreeSize--;
+                updateSummary(ancestor);
+            }
+
             // If we delete a black node, we need to fix the tree's black height
             if (nodeToReplace->isBlack == true)
             {
                 removeFix(nodeChild, nodeToReplace->parent, isLeftChild);
             }
-            delete nodeToReplace;
+            destroyNode(nodeToReplace);
             nodeToReplace = nullptr;
             treeSize--;
             return true;
@@ -387,8 +725,8 @@ bool RedBlackTree<T>::remove(const T valueToRemove)
 }
 
 // Fixes the Red-Black Tree when a black node is removed
-template <class T>
-void RedBlackTree<T>::removeFix(NodeT<T> *nodeToRemove, NodeT<T> *nodeParent, bool isLeftChild)
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::removeFix(NodeT<T> *nodeToRemove, NodeT<T> *nodeParent, bool isLeftChild)
 {
     NodeT<T> *nodeSibling;
     // A black node has been removed, so loop until black height has been fixed
@@ -534,8 +872,8 @@ void RedBlackTree<T>::removeFix(NodeT<T> *nodeToRemove, NodeT<T> *nodeParent, bo
 }
 
 // Performs a left rotation on the given node parameter
-template <class T>
-void RedBlackTree<T>::rotateLeft(NodeT<T> *nodeToRotate)
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::rotateLeft(NodeT<T> *nodeToRotate)
 {
     // The right node's left child is attached to the original node
     NodeT<T> *childNode = nodeToRotate->right;
@@ -567,11 +905,17 @@ void RedBlackTree<T>::rotateLeft(NodeT<T> *nodeToRotate)
     // Make nodeToRotate childNode's left child and update the parent pointer
     childNode->left = nodeToRotate;
     nodeToRotate->parent = childNode;
+
+    // childNode now roots the whole subtree, and nodeToRotate lost childNode's right side
+    childNode->subtreeSize = nodeToRotate->subtreeSize;
+    nodeToRotate->subtreeSize = sizeOf(nodeToRotate->left) + sizeOf(nodeToRotate->right) + 1;
+    updateSummary(nodeToRotate);
+    updateSummary(childNode);
 }
 
 // Performs a right rotation on the given node parameter
-template <class T>
-void RedBlackTree<T>::rotateRight(NodeT<T> *nodeToRotate)
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::rotateRight(NodeT<T> *nodeToRotate)
 {
     // The left node's right child is attached to the original node
     NodeT<T> *childNode = nodeToRotate->left;
@@ -603,12 +947,18 @@ void RedBlackTree<T>::rotateRight(NodeT<T> *nodeToRotate)
     // Make nodeToRotate childNode's left child and update the parent pointer
     childNode->right = nodeToRotate;
     nodeToRotate->parent = childNode;
+
+    // childNode now roots the whole subtree, and nodeToRotate lost childNode's left side
+    childNode->subtreeSize = nodeToRotate->subtreeSize;
+    nodeToRotate->subtreeSize = sizeOf(nodeToRotate->left) + sizeOf(nodeToRotate->right) + 1;
+    updateSummary(nodeToRotate);
+    updateSummary(childNode);
 }
 
 // Searches the tree for the provided parameter
 // Returns true if found, false otherwise
-template <class T>
-bool RedBlackTree<T>::search(const T valueToSearch) const
+template <class T, class Allocator>
+bool RedBlackTree<T, Allocator>::search(const T valueToSearch) const
 {
     // Begin the search from the root
     NodeT<T> *currentNode = root;
@@ -634,8 +984,8 @@ bool RedBlackTree<T>::search(const T valueToSearch) const
 }
 
 // Similar to the search function, but returns the node rather than a boolean
-template <class T>
-NodeT<T> *RedBlackTree<T>::findNode(const T valueToSearch) const
+template <class T, class Allocator>
+NodeT<T> *RedBlackTree<T, Allocator>::findNode(const T valueToSearch) const
 {
     // Begin the search from the root
     NodeT<T> *currentNode = root;
@@ -661,86 +1011,56 @@ NodeT<T> *RedBlackTree<T>::findNode(const T valueToSearch) const
 }
 
 // Returns the largest value in the tree that is less than the parameter
-template <class T>
-T RedBlackTree<T>::closestLess(const T valueToCompare) const
+template <class T, class Allocator>
+T RedBlackTree<T, Allocator>::closestLess(const T valueToCompare) const
 {
-    // If the tree is empty, we can't find a closest value
-    if (isEmpty())
-    {
-        return valueToCompare;
-    }
-
-    // Find the smallest value in the entire tree
-    NodeT<T> *smallestNodeValue = root;
-    while (smallestNodeValue->left != nullptr)
-    {
-        smallestNodeValue = smallestNodeValue->left;
-    }
-
-    if (smallestNodeValue->data >= valueToCompare)
-    {
-        return valueToCompare;
-    }
-
-    // Get a vector of all values between the smallest value and the parameter
-    vector<T> closestValues = search(smallestNodeValue->data, valueToCompare);
-
-    // Iterate through the array backwards and return the first value less than the parameter
-    T currentSmallestValue = smallestNodeValue->data;
-    for (unsigned int i = closestValues.size() - 1; i >= 0; i--)
+    // Descend once, remembering the last node passed on its right side
+    const NodeT<T> *closestNode = nullptr;
+    const NodeT<T> *currentNode = root;
+    while (currentNode != nullptr)
     {
-        if (closestValues[i] < valueToCompare)
+        if (currentNode->data < valueToCompare)
         {
-            return closestValues[i];
+            closestNode = currentNode;
+            currentNode = currentNode->right;
+        }
+        else
+        {
+            currentNode = currentNode->left;
         }
     }
 
-    // There is no smaller closest value
-    return currentSmallestValue;
+    // There is no smaller value
+    return closestNode == nullptr ? valueToCompare : closestNode->data;
 }
 
 // Returns the smallest value in the tree that is greater than the parameter
-template <class T>
-T RedBlackTree<T>::closestGreater(const T valueToCompare) const
+template <class T, class Allocator>
+T RedBlackTree<T, Allocator>::closestGreater(const T valueToCompare) const
 {
-    // If the tree is empty, we can't find a closest value
-    if (isEmpty())
-    {
-        return valueToCompare;
-    }
-
-    // Find the greatest value in the entire tree
-    NodeT<T> *greatestNodeValue = root;
-    while (greatestNodeValue->right != nullptr)
-    {
-        greatestNodeValue = greatestNodeValue->right;
-    }
-
-    if (greatestNodeValue->data <= valueToCompare)
-    {
-        return valueToCompare;
-    }
-
-    // Get a vector of all values between the parameter and the greatest value
-    vector<T> closestValues = search(valueToCompare, greatestNodeValue->data);
-
-    // Iterate through the array and return the first value greater than the parameter
-    T currentGreatestValue = greatestNodeValue->data;
-    for (unsigned int i = 0; i < closestValues.size(); i++)
+    // Descend once, remembering the last node passed on its left side
+    const NodeT<T> *closestNode = nullptr;
+    const NodeT<T> *currentNode = root;
+    while (currentNode != nullptr)
     {
-        if (closestValues[i] > valueToCompare)
+        if (currentNode->data > valueToCompare)
         {
-            return closestValues[i];
+            closestNode = currentNode;
+            currentNode = currentNode->left;
+        }
+        else
+        {
+            currentNode = currentNode->right;
         }
     }
 
-    // There is no greater closest value
-    return currentGreatestValue;
+    // There is no greater value
+    return closestNode == nullptr ? valueToCompare : closestNode->data;
 }
 
 // Returns a vector containing all of the values in the tree
-template <class T>
-vector<T> RedBlackTree<T>::values() const
+template <class T, class Allocator>
+vector<T> RedBlackTree<T, Allocator>::values() const
 {
     vector<T> treeValues;
     inOrderValues(root, treeValues);
@@ -749,8 +1069,8 @@ vector<T> RedBlackTree<T>::values() const
 
 // Returns a vector containing values between the method's first and second parameters
 // The vector is in ascending order
-template <class T>
-vector<T> RedBlackTree<T>::search(const T valueToSearch1, const T valueToSearch2) const
+template <class T, class Allocator>
+vector<T> RedBlackTree<T, Allocator>::search(const T valueToSearch1, const T valueToSearch2) const
 {
     vector<T> treeValuesInRange;
 
@@ -768,15 +1088,15 @@ vector<T> RedBlackTree<T>::search(const T valueToSearch1, const T valueToSearch2
     return treeValuesInRange;
 }
 
-// Returns a vector containing values between the method's first and second parameters
+// Appends the values between the method's first and second parameters to the treeValues vector
 // Recursively calls itself and inserts the appropriate values into the treeValues vector
-template <class T>
-vector<T> RedBlackTree<T>::rangeSearch(const NodeT<T> *currentNode, const T valueToSearch1,
-                                       const T valueToSearch2, vector<T> &treeValues) const
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::rangeSearch(const NodeT<T> *currentNode, const T valueToSearch1,
+                                             const T valueToSearch2, vector<T> &treeValues) const
 {
     if (currentNode == nullptr)
     {
-        return treeValues;
+        return;
     }
 
     // Search the left subtree
@@ -797,17 +1117,15 @@ vector<T> RedBlackTree<T>::rangeSearch(const NodeT<T> *currentNode, const T valu
     {
         rangeSearch(currentNode->right, valueToSearch1, valueToSearch2, treeValues);
     }
-
-    return treeValues;
 }
 
-// Returns a vector containing all of the values in the tree
-template <class T>
-vector<T> RedBlackTree<T>::inOrderValues(const NodeT<T> *currentNode, vector<T> &treeValues) const
+// Appends all of the values in the subtree to the treeValues vector
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::inOrderValues(const NodeT<T> *currentNode, vector<T> &treeValues) const
 {
     if (currentNode == nullptr)
     {
-        return treeValues;
+        return;
     }
 
     // Go through the left subtree
@@ -817,101 +1135,663 @@ vector<T> RedBlackTree<T>::inOrderValues(const NodeT<T> *currentNode, vector<T>
 
     // Go through the right subtree
     inOrderValues(currentNode->right, treeValues);
+}
 
-    return treeValues;
+// Returns the value with the given index in ascending order (0 is the smallest) in O(log n)
+// The index must be between 0 and size() - 1
+template <class T, class Allocator>
+T RedBlackTree<T, Allocator>::select(int index) const
+{
+    const NodeT<T> *currentNode = root;
+    while (true)
+    {
+        int leftSize = sizeOf(currentNode->left);
+        if (index < leftSize)
+        {
+            currentNode = currentNode->left;
+        }
+        else if (index > leftSize)
+        {
+            index -= leftSize + 1;
+            currentNode = currentNode->right;
+        }
+        else
+        {
+            return currentNode->data;
+        }
+    }
+}
+
+// Returns the number of values in the tree that are less than the parameter in O(log n)
+template <class T, class Allocator>
+int RedBlackTree<T, Allocator>::rank(const T valueToCompare) const
+{
+    return countLess(root, valueToCompare);
+}
+
+// Returns the count, sum, mean, variance and standard deviation of every value in O(1)
+// Only available for trees of numbers, or of pairs whose first member is a number
+template <class T, class Allocator>
+ValueSummary RedBlackTree<T, Allocator>::summary() const
+{
+    static_assert(SummaryValue<T>::isSummarised, "summary needs numeric values");
+    return summaryOf(root);
+}
+
+// Returns the summary of the values between the first and second parameters, both included, in O(log n)
+// It merges the stored summaries of the O(log n) subtrees that lie wholly inside the range
+template <class T, class Allocator>
+ValueSummary RedBlackTree<T, Allocator>::summary(const T valueToSearch1, const T valueToSearch2) const
+{
+    static_assert(SummaryValue<T>::isSummarised, "summary needs numeric values");
+    const T &lowerValue = valueToSearch1 > valueToSearch2 ? valueToSearch2 : valueToSearch1;
+    const T &higherValue = valueToSearch1 > valueToSearch2 ? valueToSearch1 : valueToSearch2;
+
+    // Find the highest node inside the range; everything in the range is in its subtree
+    const NodeT<T> *splitNode = root;
+    while (splitNode != nullptr && (splitNode->data < lowerValue || splitNode->data > higherValue))
+    {
+        splitNode = splitNode->data < lowerValue ? splitNode->right : splitNode->left;
+    }
+    ValueSummary rangeSummary;
+    if (splitNode == nullptr)
+    {
+        return rangeSummary;
+    }
+    rangeSummary.add(SummaryValue<T>::of(splitNode->data));
+
+    // On the left, each node at least lowerValue brings its right subtree with it
+    for (const NodeT<T> *currentNode = splitNode->left; currentNode != nullptr;)
+    {
+        if (currentNode->data < lowerValue)
+        {
+            currentNode = currentNode->right;
+        }
+        else
+        {
+            rangeSummary.add(SummaryValue<T>::of(currentNode->data));
+            rangeSummary.merge(summaryOf(currentNode->right));
+            currentNode = currentNode->left;
+        }
+    }
+
+    // On the right, each node at most higherValue brings its left subtree with it
+    for (const NodeT<T> *currentNode = splitNode->right; currentNode != nullptr;)
+    {
+        if (currentNode->data > higherValue)
+        {
+            currentNode = currentNode->left;
+        }
+        else
+        {
+            rangeSummary.add(SummaryValue<T>::of(currentNode->data));
+            rangeSummary.merge(summaryOf(currentNode->left));
+            currentNode = currentNode->right;
+        }
+    }
+    return rangeSummary;
 }
 
 // Returns true if the tree is empty, false otherwise
-template <class T>
-bool RedBlackTree<T>::isEmpty() const
+template <class T, class Allocator>
+bool RedBlackTree<T, Allocator>::isEmpty() const
 {
     return root == nullptr;
 }
 
 // Returns the size of the tree
-template <class T>
-int RedBlackTree<T>::size() const
+template <class T, class Allocator>
+int RedBlackTree<T, Allocator>::size() const
 {
     return treeSize;
 }
 
-void statistics(string filename)
+// Returns a copy of the allocator used for the tree's nodes
+template <class T, class Allocator>
+Allocator RedBlackTree<T, Allocator>::getAllocator() const
 {
-    RedBlackTree<double> fileStatistics;
-
-    double currentNumber = 0.0;
-    double totalSumOfValues = 0.0; // Total sum of the unique values
-    double medianOfValues = 0.0;   // Median of the unique values
-    double averageOfValues = 0.0;  // Average of the unique values
+    return Allocator(nodeAllocator);
+}
 
-    // Open the file parameter
-    ifstream currentFile(filename);
+// Moves every node into one freshly allocated contiguous arena in the given layout
+// The shape and colours of the tree are unchanged, but nodes that are visited together
+// are now stored together, so scans and descents after heavy churn walk memory in sequence
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::compact(NodeLayout layout)
+{
+    if (isEmpty())
+    {
+        return;
+    }
 
-    // Check if lines are processed correctly by reading the values into currentNumber
-    while (currentFile >> currentNumber)
+    // Decide where each node goes in the new arena
+    vector<NodeT<T> *> layoutOrder;
+    layoutOrder.reserve(treeSize);
+    if (layout == NodeLayout::VanEmdeBoas)
     {
-        // Insert the values into the fileStatistics tree
-        fileStatistics.insert(currentNumber);
+        vanEmdeBoasOrder(root, height(root), layoutOrder);
+    }
+    else
+    {
+        inOrderNodes(root, layoutOrder);
     }
 
-    // Get a vector of all the tree values
-    vector<double> fileValues = fileStatistics.values();
+    int newCapacity = layoutOrder.size();
+    NodeT<T> *newArena = NodeAllocatorTraits::allocate(nodeAllocator, newCapacity);
 
-    // The number of unique values are the size of the tree
-    int numOfValues = fileStatistics.size();
+    // Move each node into its slot, keeping the old child pointers for now
+    // and leaving a forwarding pointer to the new node in the old node's parent field
+    for (int i = 0; i < newCapacity; i++)
+    {
+        NodeT<T> *oldNode = layoutOrder[i];
+        NodeT<T> *newNode = newArena + i;
+        NodeAllocatorTraits::construct(nodeAllocator, newNode, std::move(oldNode->data));
+        newNode->isBlack = oldNode->isBlack;
+        newNode->subtreeSize = oldNode->subtreeSize;
+        copySummary(newNode, oldNode);
+        newNode->left = oldNode->left;
+        newNode->right = oldNode->right;
+        oldNode->parent = newNode;
+    }
+
+    // Redirect the child pointers through the forwarding pointers
+    for (int i = 0; i < newCapacity; i++)
+    {
+        NodeT<T> *newNode = newArena + i;
+        if (newNode->left != nullptr)
+        {
+            newNode->left = newNode->left->parent;
+        }
+        if (newNode->right != nullptr)
+        {
+            newNode->right = newNode->right->parent;
+        }
+    }
 
-    if (numOfValues != 0)
+    // Every old node has been read, so the parent pointers can now be rebuilt
+    NodeT<T> *newRoot = root->parent;
+    newRoot->parent = nullptr;
+    for (int i = 0; i < newCapacity; i++)
     {
-        // Iterate through the vector to find the total sum of all values
-        for (int i = 0; i < numOfValues; i++)
+        NodeT<T> *newNode = newArena + i;
+        if (newNode->left != nullptr)
+        {
+            newNode->left->parent = newNode;
+        }
+        if (newNode->right != nullptr)
         {
-            totalSumOfValues += fileValues[i];
+            newNode->right->parent = newNode;
         }
+    }
+
+    // Release the old nodes (including any previous arena) and switch to the new arena
+    for (int i = 0; i < newCapacity; i++)
+    {
+        destroyNode(layoutOrder[i]);
+    }
+    root = newRoot;
+    nodeArena = newArena;
+    arenaCapacity = newCapacity;
+    arenaNodesInUse = newCapacity;
+}
+
+// Returns the number of levels in the subtree
+template <class T, class Allocator>
+int RedBlackTree<T, Allocator>::height(const NodeT<T> *currentNode) const
+{
+    if (currentNode == nullptr)
+    {
+        return 0;
+    }
+    int leftHeight = height(currentNode->left);
+    int rightHeight = height(currentNode->right);
+    return 1 + (leftHeight > rightHeight ? leftHeight : rightHeight);
+}
+
+// Appends the nodes of the top `levels` levels of the subtree in van Emde Boas order
+// The top half of the levels is laid out first, followed by each bottom subtree in turn
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::vanEmdeBoasOrder(NodeT<T> *currentNode, int levels, vector<NodeT<T> *> &layoutOrder) const
+{
+    if (currentNode == nullptr || levels <= 0)
+    {
+        return;
+    }
+    if (levels == 1)
+    {
+        layoutOrder.push_back(currentNode);
+        return;
+    }
 
-        // Average is the total sum divided by the number of values
-        averageOfValues = totalSumOfValues / numOfValues;
+    int topLevels = levels / 2;
+    vanEmdeBoasOrder(currentNode, topLevels, layoutOrder);
 
-        // If there are an odd number of values
-        if (numOfValues % 2 != 0)
+    // The roots of the bottom subtrees sit just below the top half
+    vector<NodeT<T> *> bottomRoots;
+    nodesAtDepth(currentNode, topLevels, bottomRoots);
+    for (NodeT<T> *bottomRoot : bottomRoots)
+    {
+        vanEmdeBoasOrder(bottomRoot, levels - topLevels, layoutOrder);
+    }
+}
+
+// Appends the nodes that are exactly `depth` levels below currentNode, from left to right
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::nodesAtDepth(NodeT<T> *currentNode, int depth, vector<NodeT<T> *> &depthNodes) const
+{
+    if (currentNode == nullptr)
+    {
+        return;
+    }
+    if (depth == 0)
+    {
+        depthNodes.push_back(currentNode);
+        return;
+    }
+    nodesAtDepth(currentNode->left, depth - 1, depthNodes);
+    nodesAtDepth(currentNode->right, depth - 1, depthNodes);
+}
+
+// Appends the nodes of the subtree in ascending value order
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::inOrderNodes(NodeT<T> *currentNode, vector<NodeT<T> *> &layoutOrder) const
+{
+    if (currentNode == nullptr)
+    {
+        return;
+    }
+    inOrderNodes(currentNode->left, layoutOrder);
+    layoutOrder.push_back(currentNode);
+    inOrderNodes(currentNode->right, layoutOrder);
+}
+
+// Adds the values of the vector parameter to the tree in one bulk build; values already present are ignored
+// The values (and any already in the tree) are sorted in parallel unless they already are, then deduplicated, and the tree is
+// rebuilt perfectly balanced with subtrees built in parallel on the pool. Every level is black
+// except the deepest one when it is only partly filled, which is red, so all paths have the same black height
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::buildParallel(vector<T> valuesToStore, WorkStealingPool &pool)
+{
+    if (root != nullptr)
+    {
+        inOrderValues(root, valuesToStore);
+        releaseTree();
+        treeSize = 0;
+    }
+
+    if (!std::is_sorted(valuesToStore.begin(), valuesToStore.end()))
+    {
+        pool.sort(valuesToStore.begin(), valuesToStore.end());
+    }
+    valuesToStore.erase(std::unique(valuesToStore.begin(), valuesToStore.end()), valuesToStore.end());
+    size_t valueCount = valuesToStore.size();
+    if (valueCount == 0)
+    {
+        return;
+    }
+
+    // Only std::allocator nodes are created on the workers; other allocators get all of their nodes up front
+    vector<NodeT<T> *> nodeStorage;
+    WorkStealingPool *buildPool = &pool;
+    if constexpr (!allocatorIsThreadSafe)
+    {
+        nodeStorage.reserve(valueCount);
+        for (const T &value : valuesToStore)
         {
-            // The median is the middle element
-            medianOfValues = fileValues.at(numOfValues / 2);
+            nodeStorage.push_back(createNode(value));
         }
-        // Even number of values
-        else
+        buildPool = nullptr;
+    }
+
+    // Paths end either just above or at the deepest level, floor(log2(n + 1))
+    int redDepth = 0;
+    while (((size_t)2 << redDepth) <= valueCount + 1)
+    {
+        redDepth++;
+    }
+    root = buildSubtree(valuesToStore, nodeStorage.empty() ? nullptr : nodeStorage.data(), 0, valueCount, 0, redDepth, buildPool);
+    root->parent = nullptr;
+    treeSize = valueCount;
+}
+
+// Builds a balanced subtree from sortedValues[first, last) and returns its root
+// Uses the preallocated nodes if nodeStorage is not null; subtrees large enough to be
+// worth it are built in parallel when a pool is given
+template <class T, class Allocator>
+NodeT<T> *RedBlackTree<T, Allocator>::buildSubtree(const vector<T> &sortedValues, NodeT<T> *const *nodeStorage,
+                                                   size_t first, size_t last, int depth, int redDepth, WorkStealingPool *pool)
+{
+    const size_t parallelCutoff = 1 << 12;
+    if (first == last)
+    {
+        return nullptr;
+    }
+    size_t middle = first + (last - first) / 2;
+    NodeT<T> *subtreeRoot = nodeStorage != nullptr ? nodeStorage[middle] : createNode(sortedValues[middle]);
+    subtreeRoot->isBlack = depth != redDepth;
+    subtreeRoot->subtreeSize = last - first;
+
+    if (pool != nullptr && last - first > parallelCutoff)
+    {
+        pool->invoke([&]()
+                     { subtreeRoot->left = buildSubtree(sortedValues, nodeStorage, first, middle, depth + 1, redDepth, pool); },
+                     [&]()
+                     { subtreeRoot->right = buildSubtree(sortedValues, nodeStorage, middle + 1, last, depth + 1, redDepth, pool); });
+    }
+    else
+    {
+        subtreeRoot->left = buildSubtree(sortedValues, nodeStorage, first, middle, depth + 1, redDepth, pool);
+        subtreeRoot->right = buildSubtree(sortedValues, nodeStorage, middle + 1, last, depth + 1, redDepth, pool);
+    }
+
+    // Assign parent pointers
+    if (subtreeRoot->left != nullptr)
+    {
+        subtreeRoot->left->parent = subtreeRoot;
+    }
+    if (subtreeRoot->right != nullptr)
+    {
+        subtreeRoot->right->parent = subtreeRoot;
+    }
+    updateSummary(subtreeRoot);
+    return subtreeRoot;
+}
+
+// Returns the number of nodes in the subtree, 0 for an empty one
+template <class T, class Allocator>
+int RedBlackTree<T, Allocator>::sizeOf(const NodeT<T> *currentNode)
+{
+    return currentNode == nullptr ? 0 : currentNode->subtreeSize;
+}
+
+// Returns the summary of every value in the subtree, an empty one for an empty subtree
+template <class T, class Allocator>
+ValueSummary RedBlackTree<T, Allocator>::summaryOf(const NodeT<T> *currentNode)
+{
+    ValueSummary subtreeSummary;
+    if constexpr (SummaryValue<T>::isSummarised)
+    {
+        if (currentNode != nullptr)
         {
-            // The median is the average of the two central values
-            medianOfValues = (fileValues.at((numOfValues - 1) / 2) + fileValues.at(numOfValues / 2)) / 2.0;
+            subtreeSummary.count = currentNode->subtreeSize;
+            subtreeSummary.sum = currentNode->subtreeSum;
+            subtreeSummary.squaredDeviations = currentNode->subtreeSquaredDeviations;
         }
-        // Print the relevant information
-        cout << "# of values: " << numOfValues << endl;
-        cout << "average: " << averageOfValues << endl;
-        cout << "median: " << medianOfValues << endl;
+    }
+    return subtreeSummary;
+}
+
+// Recomputes the node's summary fields from its value and its children's fields
+// Does nothing for trees whose values are not summarised
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::updateSummary(NodeT<T> *currentNode)
+{
+    if constexpr (SummaryValue<T>::isSummarised)
+    {
+        ValueSummary subtreeSummary = summaryOf(currentNode->left);
+        subtreeSummary.add(SummaryValue<T>::of(currentNode->data));
+        subtreeSummary.merge(summaryOf(currentNode->right));
+        currentNode->subtreeSum = subtreeSummary.sum;
+        currentNode->subtreeSquaredDeviations = subtreeSummary.squaredDeviations;
+    }
+}
 
-        // Find the greatest closest value less than 42.0
-        if (fileStatistics.closestLess(42.0) != 42.0)
+// Copies the summary fields of a node whose subtree has the same values
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::copySummary(NodeT<T> *targetNode, const NodeT<T> *sourceNode)
+{
+    if constexpr (SummaryValue<T>::isSummarised)
+    {
+        targetNode->subtreeSum = sourceNode->subtreeSum;
+        targetNode->subtreeSquaredDeviations = sourceNode->subtreeSquaredDeviations;
+    }
+}
+
+// Returns the number of values in the subtree that are less than the parameter
+template <class T, class Allocator>
+int RedBlackTree<T, Allocator>::countLess(const NodeT<T> *currentNode, const T &valueToCompare)
+{
+    int count = 0;
+    while (currentNode != nullptr)
+    {
+        if (currentNode->data < valueToCompare)
         {
-            cout << "closest < 42: " << fileStatistics.closestLess(42.0) << endl;
+            count += sizeOf(currentNode->left) + 1;
+            currentNode = currentNode->right;
         }
         else
         {
-            cout << "closest < 42: None" << endl;
+            currentNode = currentNode->left;
         }
-        // Find the smallest closest value greater than 42.0
-        if (fileStatistics.closestGreater(42.0) != 42.0)
+    }
+    return count;
+}
+
+// Returns the number of values in the subtree that are greater than the parameter
+template <class T, class Allocator>
+int RedBlackTree<T, Allocator>::countGreater(const NodeT<T> *currentNode, const T &valueToCompare)
+{
+    int count = 0;
+    while (currentNode != nullptr)
+    {
+        if (currentNode->data > valueToCompare)
         {
-            cout << "closest > 42: " << fileStatistics.closestGreater(42.0) << endl;
+            count += sizeOf(currentNode->right) + 1;
+            currentNode = currentNode->left;
         }
         else
         {
-            cout << "closest > 42: None" << endl;
+            currentNode = currentNode->right;
         }
     }
+    return count;
+}
+
+// Returns a vector containing all of the values in the tree, copied out in parallel
+// Subtree sizes give every subtree its slice of the output up front, so large subtrees are
+// written by different workers straight into place
+template <class T, class Allocator>
+vector<T> RedBlackTree<T, Allocator>::valuesParallel(WorkStealingPool &pool) const
+{
+    vector<T> treeValues(treeSize);
+    exportSubtree(root, treeValues.data(), pool);
+    return treeValues;
+}
+
+// Returns a vector containing values between the method's first and second parameters, copied out in parallel
+// The vector is in ascending order
+template <class T, class Allocator>
+vector<T> RedBlackTree<T, Allocator>::searchParallel(const T valueToSearch1, const T valueToSearch2, WorkStealingPool &pool) const
+{
+    const int parallelCutoff = 1 << 12;
+    const T &lowerValue = valueToSearch1 > valueToSearch2 ? valueToSearch2 : valueToSearch1;
+    const T &higherValue = valueToSearch1 > valueToSearch2 ? valueToSearch1 : valueToSearch2;
+
+    // Find the highest node inside the bounds; the values in range are the part of its
+    // left subtree above the lower bound, itself, and the part of its right subtree below the higher bound
+    const NodeT<T> *splitNode = root;
+    while (splitNode != nullptr && (splitNode->data < lowerValue || splitNode->data > higherValue))
+    {
+        splitNode = splitNode->data < lowerValue ? splitNode->right : splitNode->left;
+    }
+    if (splitNode == nullptr)
+    {
+        return vector<T>();
+    }
+
+    int leftCount = sizeOf(splitNode->left) - countLess(splitNode->left, lowerValue);
+    int rightCount = sizeOf(splitNode->right) - countGreater(splitNode->right, higherValue);
+    vector<T> treeValuesInRange(leftCount + 1 + rightCount);
+    T *output = treeValuesInRange.data();
+    treeValuesInRange[leftCount] = splitNode->data;
+    if (splitNode->subtreeSize > parallelCutoff)
+    {
+        pool.invoke([&]()
+                    { exportAtLeast(splitNode->left, lowerValue, output, pool); },
+                    [&]()
+                    { exportAtMost(splitNode->right, higherValue, output + leftCount + 1, pool); });
+    }
+    else
+    {
+        exportAtLeast(splitNode->left, lowerValue, output, pool);
+        exportAtMost(splitNode->right, higherValue, output + leftCount + 1, pool);
+    }
+    return treeValuesInRange;
+}
+
+// Writes the subtree's values in order starting at output
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::exportSubtree(const NodeT<T> *currentNode, T *output, WorkStealingPool &pool)
+{
+    const int parallelCutoff = 1 << 12;
+    if (currentNode == nullptr)
+    {
+        return;
+    }
+    int leftCount = sizeOf(currentNode->left);
+    output[leftCount] = currentNode->data;
+    if (currentNode->subtreeSize > parallelCutoff)
+    {
+        pool.invoke([&]()
+                    { exportSubtree(currentNode->left, output, pool); },
+                    [&]()
+                    { exportSubtree(currentNode->right, output + leftCount + 1, pool); });
+    }
+    else
+    {
+        exportSubtree(currentNode->left, output, pool);
+        exportSubtree(currentNode->right, output + leftCount + 1, pool);
+    }
+}
+
+// Writes the subtree's values that are not less than lowerValue in order starting at output
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::exportAtLeast(const NodeT<T> *currentNode, const T &lowerValue, T *output, WorkStealingPool &pool)
+{
+    const int parallelCutoff = 1 << 12;
+
+    // Skip down the nodes that are below the bound along with their left subtrees
+    while (currentNode != nullptr && currentNode->data < lowerValue)
+    {
+        currentNode = currentNode->right;
+    }
+    if (currentNode == nullptr)
+    {
+        return;
+    }
+
+    // The whole right subtree is in range, so it can be exported alongside the rest of the left side
+    int leftCount = sizeOf(currentNode->left) - countLess(currentNode->left, lowerValue);
+    output[leftCount] = currentNode->data;
+    if (currentNode->subtreeSize > parallelCutoff)
+    {
+        pool.invoke([&]()
+                    { exportAtLeast(currentNode->left, lowerValue, output, pool); },
+                    [&]()
+                    { exportSubtree(currentNode->right, output + leftCount + 1, pool); });
+    }
+    else
+    {
+        exportAtLeast(currentNode->left, lowerValue, output, pool);
+        exportSubtree(currentNode->right, output + leftCount + 1, pool);
+    }
+}
+
+// Writes the subtree's values that are not greater than higherValue in order starting at output
+template <class T, class Allocator>
+void RedBlackTree<T, Allocator>::exportAtMost(const NodeT<T> *currentNode, const T &higherValue, T *output, WorkStealingPool &pool)
+{
+    const int parallelCutoff = 1 << 12;
+
+    // Skip down the nodes that are above the bound along with their right subtrees
+    while (currentNode != nullptr && currentNode->data > higherValue)
+    {
+        currentNode = currentNode->left;
+    }
+    if (currentNode == nullptr)
+    {
+        return;
+    }
+
+    // The whole left subtree is in range, so it can be exported alongside the rest of the right side
+    int leftCount = sizeOf(currentNode->left);
+    output[leftCount] = currentNode->data;
+    if (currentNode->subtreeSize > parallelCutoff)
+    {
+        pool.invoke([&]()
+                    { exportSubtree(currentNode->left, output, pool); },
+                    [&]()
+                    { exportAtMost(currentNode->right, higherValue, output + leftCount + 1, pool); });
+    }
     else
     {
-        // Tree size is 0, so the file does not contain any value
-        cout << "The file is empty." << endl;
+        exportSubtree(currentNode->left, output, pool);
+        exportAtMost(currentNode->right, higherValue, output + leftCount + 1, pool);
+    }
+}
+
+// Returns the given quantiles of project(value) over the values in the tree, in the order the fractions are given
+// project must keep the tree's order, so that the i-th smallest value projects to the i-th smallest number.
+// Each fraction is clamped to [0, 1]; 0 is the minimum, 0.5 the median and 1 the maximum, and a NaN fraction
+// gives NaN. Quantiles that fall between two values are interpolated linearly between them, and all are 0
+// if the tree is empty.
+// Each quantile takes two O(log n) selects, unless there are so many that one sorted traversal is cheaper
+template <class T, class Allocator, class Projection>
+vector<double> quantiles(const RedBlackTree<T, Allocator> &values, const vector<double> &fractions, Projection project)
+{
+    vector<double> results;
+    results.reserve(fractions.size());
+    int numOfValues = values.size();
+    if (numOfValues == 0)
+    {
+        results.assign(fractions.size(), 0.0);
+        return results;
     }
 
-    currentFile.close();
+    int treeHeight = 1;
+    while ((1 << treeHeight) <= numOfValues)
+    {
+        treeHeight++;
+    }
+    vector<T> sortedValues;
+    if ((long long)fractions.size() * 2 * treeHeight > numOfValues)
+    {
+        sortedValues = values.values();
+    }
+    auto valueAt = [&](int index)
+    {
+        return (double)project(sortedValues.empty() ? values.select(index) : sortedValues[index]);
+    };
+
+    for (double fraction : fractions)
+    {
+        // NaN passes through the clamp, and converting it to an index would be undefined
+        if (std::isnan(fraction))
+        {
+            results.push_back(std::numeric_limits<double>::quiet_NaN());
+            continue;
+        }
+        fraction = std::min(std::max(fraction, 0.0), 1.0);
+        double position = fraction * (numOfValues - 1);
+        int lowerIndex = (int)position;
+        double lowerValue = valueAt(lowerIndex);
+        if (lowerIndex + 1 >= numOfValues || position == lowerIndex)
+        {
+            results.push_back(lowerValue);
+        }
+        else
+        {
+            double higherValue = valueAt(lowerIndex + 1);
+            results.push_back(lowerValue + (higherValue - lowerValue) * (position - lowerIndex));
+        }
+    }
+    return results;
+}
+
+// Returns the given quantiles of the values in the tree, in the order the fractions are given
+template <class Allocator>
+vector<double> quantiles(const RedBlackTree<double, Allocator> &values, const vector<double> &fractions)
+{
+    return quantiles(values, fractions, [](double value)
+                     { return value; });
 }
\ No newline at end of file
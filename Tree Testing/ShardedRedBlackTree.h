@@ -0,0 +1,380 @@
+#pragma once
+#include "ConcurrentRedBlackTree.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+// Red-Black tree split into key ranges, each an independent RedBlackTree with its own lock
+// Shard i holds the values v with boundaries[i - 1] <= v < boundaries[i], so writers to
+// different ranges run in parallel.
+// The boundaries are an immutable vector that rebalance replaces as a whole. An operation picks its
+// shard from the boundaries it loaded, locks that shard and checks the boundaries again, retrying in
+// the rare case a rebalance moved its value elsewhere in between. Rebalancing locks only the shards
+// whose ranges change, moves just the values that cross a changed boundary, and publishes the new
+// boundaries before unlocking them, so operations on every other shard never wait for it.
+// Range searches and values visit the shards one at a time in ascending order, so they are
+// not snapshots while writers are active; they start again if a rebalance ran meanwhile
+template <class T>
+class ShardedRedBlackTree
+{
+    // Private attributes and helper methods
+private:
+    struct alignas(64) Shard
+    {
+        RedBlackTree<T> tree;
+        mutable std::shared_mutex shardLock;
+    };
+    using ShardBoundaries = std::shared_ptr<const vector<T>>;
+
+    ShardBoundaries boundaries; // Read and replaced with std::atomic_load and std::atomic_store
+    vector<Shard> shards;
+    std::mutex rebalanceLock; // Lets one rebalance run at a time
+    ShardBoundaries currentBoundaries() const;
+    static int shardIndex(const vector<T> &shardBoundaries, const T &value);
+    template <class ShardGuard>
+    int lockShardOf(const T &value, ShardGuard &guard) const;
+    void moveValues(vector<T> newBoundaries, vector<std::unique_lock<std::shared_mutex>> &shardGuards);
+
+    // Public methods
+public:
+    explicit ShardedRedBlackTree(vector<T> shardBoundaries = vector<T>());
+    ShardedRedBlackTree(const ShardedRedBlackTree<T> &treeParameter) = delete;
+    ShardedRedBlackTree<T> &operator=(const ShardedRedBlackTree<T> &treeParameter) = delete;
+    bool insert(const T valueToStore);
+    bool remove(const T valueToRemove);
+    bool search(const T valueToSearch) const;
+    vector<T> search(const T valueToSearch1, const T valueToSearch2) const;
+    T closestLess(const T valueToCompare) const;
+    T closestGreater(const T valueToCompare) const;
+    vector<T> values() const;
+    int size() const;
+    int shardCount() const;
+    vector<T> shardBoundaries() const;
+    vector<int> shardSizes() const;
+    void rebalance();
+    bool rebalance(vector<T> newBoundaries);
+};
+
+// Constructor
+// The tree has one more shard than there are boundaries, which must be in ascending order
+template <class T>
+ShardedRedBlackTree<T>::ShardedRedBlackTree(vector<T> shardBoundaries) : shards(shardBoundaries.size() + 1)
+{
+    std::sort(shardBoundaries.begin(), shardBoundaries.end());
+    boundaries = std::make_shared<const vector<T>>(std::move(shardBoundaries));
+}
+
+// Returns the boundaries currently in force; they stay valid for as long as the caller keeps them
+template <class T>
+typename ShardedRedBlackTree<T>::ShardBoundaries ShardedRedBlackTree<T>::currentBoundaries() const
+{
+    return std::atomic_load(&boundaries);
+}
+
+// Returns the index of the shard whose range contains the value
+template <class T>
+int ShardedRedBlackTree<T>::shardIndex(const vector<T> &shardBoundaries, const T &value)
+{
+    return std::upper_bound(shardBoundaries.begin(), shardBoundaries.end(), value) - shardBoundaries.begin();
+}
+
+// Locks the shard whose range contains the value with guard (a std::unique_lock or std::shared_lock)
+// and returns its index
+// A rebalance publishes new boundaries while it still holds every shard it changed, so once the shard is
+// locked, checking the boundaries again tells whether the value still belongs to it
+template <class T>
+template <class ShardGuard>
+int ShardedRedBlackTree<T>::lockShardOf(const T &value, ShardGuard &guard) const
+{
+    ShardBoundaries shardBoundaries = currentBoundaries();
+    while (true)
+    {
+        int index = shardIndex(*shardBoundaries, value);
+        guard = ShardGuard(shards[index].shardLock);
+        ShardBoundaries latestBoundaries = currentBoundaries();
+        if (latestBoundaries == shardBoundaries || shardIndex(*latestBoundaries, value) == index)
+        {
+            return index;
+        }
+        guard.unlock();
+        shardBoundaries = latestBoundaries;
+    }
+}
+
+// Inserts the value parameter
+// Returns true on success or false if the value is already present
+template <class T>
+bool ShardedRedBlackTree<T>::insert(const T valueToStore)
+{
+    std::unique_lock<std::shared_mutex> guard;
+    int index = lockShardOf(valueToStore, guard);
+    return shards[index].tree.insert(valueToStore);
+}
+
+// Removes the value parameter
+// Returns true on success or false if the value is not present
+template <class T>
+bool ShardedRedBlackTree<T>::remove(const T valueToRemove)
+{
+    std::unique_lock<std::shared_mutex> guard;
+    int index = lockShardOf(valueToRemove, guard);
+    return shards[index].tree.remove(valueToRemove);
+}
+
+// Searches the tree for the provided parameter
+// Returns true if found, false otherwise
+template <class T>
+bool ShardedRedBlackTree<T>::search(const T valueToSearch) const
+{
+    std::shared_lock<std::shared_mutex> guard;
+    int index = lockShardOf(valueToSearch, guard);
+    return shards[index].tree.search(valueToSearch);
+}
+
+// Returns a vector containing values between the method's first and second parameters
+// Only the shards whose ranges overlap the bounds are visited
+template <class T>
+vector<T> ShardedRedBlackTree<T>::search(const T valueToSearch1, const T valueToSearch2) const
+{
+    const T &lowerValue = valueToSearch1 > valueToSearch2 ? valueToSearch2 : valueToSearch1;
+    const T &higherValue = valueToSearch1 > valueToSearch2 ? valueToSearch1 : valueToSearch2;
+    vector<T> treeValuesInRange;
+    ShardBoundaries shardBoundaries;
+    do
+    {
+        treeValuesInRange.clear();
+        shardBoundaries = currentBoundaries();
+        int lastShard = shardIndex(*shardBoundaries, higherValue);
+        for (int i = shardIndex(*shardBoundaries, lowerValue); i <= lastShard; i++)
+        {
+            std::shared_lock<std::shared_mutex> guard(shards[i].shardLock);
+            vector<T> shardValues = shards[i].tree.search(lowerValue, higherValue);
+            treeValuesInRange.insert(treeValuesInRange.end(), shardValues.begin(), shardValues.end());
+        }
+    } while (currentBoundaries() != shardBoundaries);
+    return treeValuesInRange;
+}
+
+// Returns the largest value in the tree that is less than the parameter
+// Returns the parameter if there is no such value
+template <class T>
+T ShardedRedBlackTree<T>::closestLess(const T valueToCompare) const
+{
+    T closestValue = valueToCompare;
+    ShardBoundaries shardBoundaries;
+    do
+    {
+        closestValue = valueToCompare;
+        shardBoundaries = currentBoundaries();
+
+        // Lower shards only hold smaller values, so the first shard with an answer has the closest one
+        for (int i = shardIndex(*shardBoundaries, valueToCompare); i >= 0 && closestValue == valueToCompare; i--)
+        {
+            std::shared_lock<std::shared_mutex> guard(shards[i].shardLock);
+            closestValue = shards[i].tree.closestLess(valueToCompare);
+        }
+    } while (currentBoundaries() != shardBoundaries);
+    return closestValue;
+}
+
+// Returns the smallest value in the tree that is greater than the parameter
+// Returns the parameter if there is no such value
+template <class T>
+T ShardedRedBlackTree<T>::closestGreater(const T valueToCompare) const
+{
+    T closestValue = valueToCompare;
+    ShardBoundaries shardBoundaries;
+    do
+    {
+        closestValue = valueToCompare;
+        shardBoundaries = currentBoundaries();
+        for (int i = shardIndex(*shardBoundaries, valueToCompare); i < (int)shards.size() && closestValue == valueToCompare; i++)
+        {
+            std::shared_lock<std::shared_mutex> guard(shards[i].shardLock);
+            closestValue = shards[i].tree.closestGreater(valueToCompare);
+        }
+    } while (currentBoundaries() != shardBoundaries);
+    return closestValue;
+}
+
+// Returns a vector containing all of the values in the tree in ascending order
+template <class T>
+vector<T> ShardedRedBlackTree<T>::values() const
+{
+    vector<T> treeValues;
+    ShardBoundaries shardBoundaries;
+    do
+    {
+        treeValues.clear();
+        shardBoundaries = currentBoundaries();
+        for (const Shard &shard : shards)
+        {
+            std::shared_lock<std::shared_mutex> guard(shard.shardLock);
+            vector<T> shardValues = shard.tree.values();
+            treeValues.insert(treeValues.end(), shardValues.begin(), shardValues.end());
+        }
+    } while (currentBoundaries() != shardBoundaries);
+    return treeValues;
+}
+
+// Returns the number of values in the tree
+template <class T>
+int ShardedRedBlackTree<T>::size() const
+{
+    int treeSize = 0;
+    for (int shardSize : shardSizes())
+    {
+        treeSize += shardSize;
+    }
+    return treeSize;
+}
+
+// Returns the number of shards
+template <class T>
+int ShardedRedBlackTree<T>::shardCount() const
+{
+    return shards.size();
+}
+
+// Returns the current shard boundaries in ascending order
+template <class T>
+vector<T> ShardedRedBlackTree<T>::shardBoundaries() const
+{
+    return *currentBoundaries();
+}
+
+// Returns the number of values in each shard, lowest range first
+template <class T>
+vector<int> ShardedRedBlackTree<T>::shardSizes() const
+{
+    vector<int> sizes;
+    for (const Shard &shard : shards)
+    {
+        std::shared_lock<std::shared_mutex> guard(shard.shardLock);
+        sizes.push_back(shard.tree.size());
+    }
+    return sizes;
+}
+
+// Moves the boundaries so every shard holds the same number of values (within one)
+// Every shard is locked while the new boundaries are picked with a few selects, which keeps them
+// consistent with the values; the shards whose ranges stay the same are unlocked before any value moves
+// Does nothing if there are fewer values than shards
+template <class T>
+void ShardedRedBlackTree<T>::rebalance()
+{
+    std::lock_guard<std::mutex> rebalanceGuard(rebalanceLock);
+    vector<std::unique_lock<std::shared_mutex>> shardGuards;
+    size_t treeSize = 0;
+    for (Shard &shard : shards)
+    {
+        shardGuards.emplace_back(shard.shardLock);
+        treeSize += shard.tree.size();
+    }
+    if (treeSize < shards.size())
+    {
+        return;
+    }
+
+    // Boundary i is the value at rank i * n / shards across the shards in order
+    vector<T> newBoundaries;
+    size_t shard = 0;
+    size_t valuesBefore = 0;
+    for (size_t i = 1; i < shards.size(); i++)
+    {
+        size_t boundaryRank = i * treeSize / shards.size();
+        while (boundaryRank >= valuesBefore + shards[shard].tree.size())
+        {
+            valuesBefore += shards[shard].tree.size();
+            shard++;
+        }
+        newBoundaries.push_back(shards[shard].tree.select(boundaryRank - valuesBefore));
+    }
+    moveValues(std::move(newBoundaries), shardGuards);
+}
+
+// Replaces the boundaries, locking only the shards whose ranges change
+// Returns false and changes nothing unless there is one boundary fewer than there are shards
+template <class T>
+bool ShardedRedBlackTree<T>::rebalance(vector<T> newBoundaries)
+{
+    if (newBoundaries.size() + 1 != shards.size())
+    {
+        return false;
+    }
+    std::sort(newBoundaries.begin(), newBoundaries.end());
+
+    // Shard i's range changes if either of its boundaries does; locks are taken in ascending order
+    std::lock_guard<std::mutex> rebalanceGuard(rebalanceLock);
+    ShardBoundaries oldBoundaries = currentBoundaries();
+    vector<std::unique_lock<std::shared_mutex>> shardGuards(shards.size());
+    for (size_t i = 0; i < shards.size(); i++)
+    {
+        bool lowerChanged = i > 0 && !((*oldBoundaries)[i - 1] == newBoundaries[i - 1]);
+        bool upperChanged = i + 1 < shards.size() && !((*oldBoundaries)[i] == newBoundaries[i]);
+        if (lowerChanged || upperChanged)
+        {
+            shardGuards[i] = std::unique_lock<std::shared_mutex>(shards[i].shardLock);
+        }
+    }
+    moveValues(std::move(newBoundaries), shardGuards);
+    return true;
+}
+
+// Moves the values that cross a changed boundary into their new shards and publishes the new boundaries
+// Must be called with rebalanceLock held and with shardGuards holding at least every shard whose range
+// changes; any other shard it holds is unlocked first. A value can only move between shards whose ranges
+// both change, so every shard touched is locked
+template <class T>
+void ShardedRedBlackTree<T>::moveValues(vector<T> newBoundaries, vector<std::unique_lock<std::shared_mutex>> &shardGuards)
+{
+    ShardBoundaries oldBoundaries = currentBoundaries();
+    vector<T> movingValues;
+    for (size_t i = 0; i < shards.size(); i++)
+    {
+        bool lowerChanged = i > 0 && !((*oldBoundaries)[i - 1] == newBoundaries[i - 1]);
+        bool upperChanged = i + 1 < shards.size() && !((*oldBoundaries)[i] == newBoundaries[i]);
+        if (!lowerChanged && !upperChanged)
+        {
+            if (shardGuards[i].owns_lock())
+            {
+                shardGuards[i].unlock();
+            }
+            continue;
+        }
+
+        // Take out the values below the new lower boundary and from the new upper boundary on,
+        // each run found with rank and select and copied with one range search
+        RedBlackTree<T> &shardTree = shards[i].tree;
+        vector<T> leavingValues;
+        if (lowerChanged)
+        {
+            int valuesBelow = shardTree.rank(newBoundaries[i - 1]);
+            if (valuesBelow > 0)
+            {
+                leavingValues = shardTree.search(shardTree.select(0), shardTree.select(valuesBelow - 1));
+            }
+        }
+        if (upperChanged)
+        {
+            int firstAbove = shardTree.rank(newBoundaries[i]);
+            if (firstAbove < shardTree.size())
+            {
+                vector<T> valuesAbove = shardTree.search(shardTree.select(firstAbove), shardTree.select(shardTree.size() - 1));
+                leavingValues.insert(leavingValues.end(), valuesAbove.begin(), valuesAbove.end());
+            }
+        }
+        for (const T &value : leavingValues)
+        {
+            shardTree.remove(value);
+        }
+        movingValues.insert(movingValues.end(), leavingValues.begin(), leavingValues.end());
+    }
+
+    for (const T &value : movingValues)
+    {
+        shards[shardIndex(newBoundaries, value)].tree.insert(value);
+    }
+    std::atomic_store(&boundaries, ShardBoundaries(std::make_shared<const vector<T>>(std::move(newBoundaries))));
+}
@@ -0,0 +1,352 @@
+#pragma once
+#include "RedBlackTree.h"
+#include "NumberFileParser.h"
+#include "TDigest.h"
+
+// Statistics of a file of numbers or of a RedBlackTree<double>: computeStatistics returns them as a
+// StatisticsResult, printStatistics prints one, and statistics() does both for a file
+// Kept apart from RedBlackTree.h so that code using only the tree does not pull in the file readers
+
+// How computeStatistics treats the values of a file
+enum class StatisticsBackend
+{
+    Exact,      // The values go into a RedBlackTree, which has to fit in memory
+    Approximate // Every value streams through a TDigest in bounded memory; the median and quantiles are approximate
+};
+
+// Which values of a file computeStatistics counts
+enum class StatisticsPopulation
+{
+    UniqueValues, // Each distinct value once; only the exact backend can count these
+    AllValues     // Every value in the file, repeats included
+};
+
+// What computeStatistics reads, which closest values it looks up and which quantiles it reports
+struct StatisticsOptions
+{
+    StatisticsBackend backend = StatisticsBackend::Exact;
+    StatisticsPopulation population = StatisticsPopulation::UniqueValues;
+    double compression = 200.0; // Of the TDigest used by the approximate backend
+    IngestMode ingestMode = IngestMode::Parallel; // Used by the exact backend
+    vector<double> queryPoints = {42.0}; // Points whose closest smaller and greater values are reported
+    vector<double> quantileFractions;    // For example {0.5, 0.9, 0.99, 0.999}
+};
+
+// The closest values on either side of one query point
+struct StatisticsQuery
+{
+    double point = 0.0;
+    bool hasLess = false;        // False if no value is less than the point
+    double closestLess = 0.0;    // Largest value less than the point
+    bool hasGreater = false;     // False if no value is greater than the point
+    double closestGreater = 0.0; // Smallest value greater than the point
+};
+
+// One requested quantile
+struct StatisticsQuantile
+{
+    double fraction = 0.0; // 0.5 for the median, 0.99 for p99
+    double value = 0.0;
+};
+
+// Statistics of the values of a file or tree, as computeStatistics returns them
+struct StatisticsResult
+{
+    bool isSupported = true; // False if the backend cannot count the requested population; nothing else is filled in
+    StatisticsPopulation population = StatisticsPopulation::UniqueValues; // Which values were counted
+    long long count = 0;
+    bool isApproximate = false; // Median, variance and quantiles come from the approximate backend
+    double sum = 0.0;
+    double average = 0.0;
+    double median = 0.0; // Average of the two central values when the count is even
+    double variance = 0.0; // Population variance
+    double standardDeviation = 0.0;
+    vector<StatisticsQuery> queries; // One per query point, in the order they were given
+    vector<StatisticsQuantile> quantiles; // One per quantile fraction, in the order they were given
+};
+
+// Returns the statistics of project(value) over the values in the tree
+// below(point) and above(point) are the keys just under and just over every value equal to point,
+// so that the closest values around a query point skip any values equal to it
+template <class T, class Allocator, class Projection, class KeyBelow, class KeyAbove>
+StatisticsResult computeTreeStatistics(const RedBlackTree<T, Allocator> &values, const StatisticsOptions &options,
+                                       Projection project, KeyBelow below, KeyAbove above)
+{
+    StatisticsResult result;
+    int numOfValues = values.size();
+    result.count = numOfValues;
+    if (numOfValues == 0)
+    {
+        return result;
+    }
+
+    ValueSummary valueSummary = values.summary();
+    result.sum = valueSummary.sum;
+    result.average = valueSummary.mean();
+    result.variance = valueSummary.variance();
+    result.standardDeviation = valueSummary.standardDeviation();
+
+    if (numOfValues % 2 != 0)
+    {
+        // The median is the middle element
+        result.median = project(values.select(numOfValues / 2));
+    }
+    else
+    {
+        // The median is the average of the two central values
+        result.median = (project(values.select((numOfValues - 1) / 2)) + project(values.select(numOfValues / 2))) / 2.0;
+    }
+
+    for (double point : options.queryPoints)
+    {
+        StatisticsQuery query;
+        query.point = point;
+        T lessKey = below(point);
+        T closestLess = values.closestLess(lessKey);
+        query.hasLess = closestLess != lessKey;
+        query.closestLess = query.hasLess ? project(closestLess) : point;
+        T greaterKey = above(point);
+        T closestGreater = values.closestGreater(greaterKey);
+        query.hasGreater = closestGreater != greaterKey;
+        query.closestGreater = query.hasGreater ? project(closestGreater) : point;
+        result.queries.push_back(query);
+    }
+    vector<double> quantileValues = quantiles(values, options.quantileFractions, project);
+    for (size_t i = 0; i < quantileValues.size(); i++)
+    {
+        result.quantiles.push_back(StatisticsQuantile{options.quantileFractions[i], quantileValues[i]});
+    }
+    return result;
+}
+
+// Returns the statistics of the values in the tree, which holds each value once
+// The sum, mean and spread come from the root's summary in O(1), and the median, each query point
+// and each quantile take O(log n), so no values are exported
+inline StatisticsResult computeStatistics(const RedBlackTree<double> &values, const StatisticsOptions &options = StatisticsOptions())
+{
+    auto identity = [](double value)
+    { return value; };
+    StatisticsResult result = computeTreeStatistics(values, options, identity, identity, identity);
+    result.population = StatisticsPopulation::UniqueValues;
+    return result;
+}
+
+// Returns the statistics of every value in the tree, whose keys are (value, position in the file) pairs
+// so that repeated values stay distinct; the costs are those of the RedBlackTree<double> overload
+inline StatisticsResult computeStatistics(const RedBlackTree<std::pair<double, long long>> &samples, const StatisticsOptions &options = StatisticsOptions())
+{
+    StatisticsResult result = computeTreeStatistics(
+        samples, options, [](const std::pair<double, long long> &sample)
+        { return sample.first; },
+        [](double point)
+        { return std::make_pair(point, std::numeric_limits<long long>::min()); },
+        [](double point)
+        { return std::make_pair(point, std::numeric_limits<long long>::max()); });
+    result.population = StatisticsPopulation::AllValues;
+    return result;
+}
+
+// Returns approximate statistics of every value in the file, repeats included, in bounded memory
+// The file is read in fixed-size blocks by an AsyncFileReader, so pipes and other streams stay bounded too,
+// and the values of each block are streamed through a TDigest for the median and quantiles
+// (see TDigest.h for the error bound); the count, sum, average, variance, and the closest values
+// around each query point are exact up to rounding
+// A digest cannot tell which values it has already seen, so only StatisticsPopulation::AllValues is
+// supported; for UniqueValues the result has isSupported set to false
+inline StatisticsResult computeApproximateStatistics(string filename, const StatisticsOptions &options)
+{
+    StatisticsResult result;
+    result.isApproximate = true;
+    result.population = options.population;
+    if (options.population != StatisticsPopulation::AllValues)
+    {
+        result.isSupported = false;
+        return result;
+    }
+    TDigest digest(options.compression);
+    ValueSummary valueSummary;
+    vector<StatisticsQuery> queries;
+    for (double point : options.queryPoints)
+    {
+        StatisticsQuery query;
+        query.point = point;
+        query.closestLess = query.closestGreater = point;
+        queries.push_back(query);
+    }
+
+    AsyncFileReader reader;
+    vector<double> blockNumbers;
+    readNumberBlocks(filename, blockNumbers, reader, [&](vector<double> &numbers)
+                     {
+                         for (double value : numbers)
+                         {
+                             digest.add(value);
+                             valueSummary.add(value);
+                             for (StatisticsQuery &query : queries)
+                             {
+                                 if (value < query.point && (!query.hasLess || value > query.closestLess))
+                                 {
+                                     query.hasLess = true;
+                                     query.closestLess = value;
+                                 }
+                                 if (value > query.point && (!query.hasGreater || value < query.closestGreater))
+                                 {
+                                     query.hasGreater = true;
+                                     query.closestGreater = value;
+                                 }
+                             }
+                         }
+                         numbers.clear(); });
+
+    result.count = valueSummary.count;
+    if (result.count == 0)
+    {
+        return result;
+    }
+    result.sum = valueSummary.sum;
+    result.average = valueSummary.mean();
+    result.variance = valueSummary.variance();
+    result.standardDeviation = valueSummary.standardDeviation();
+    result.median = digest.quantile(0.5);
+    result.queries = queries;
+    for (double fraction : options.quantileFractions)
+    {
+        result.quantiles.push_back(StatisticsQuantile{fraction, digest.quantile(fraction)});
+    }
+    return result;
+}
+
+// Reads the values of the file into a vector as options.ingestMode says; Pipelined reads are handled by the caller
+// The parallel reader deduplicates unless every value is asked for
+inline void readStatisticsValues(string filename, const StatisticsOptions &options, vector<double> &fileNumbers)
+{
+    // Map the file and parse every value in place
+    if (options.ingestMode == IngestMode::Parallel && options.population == StatisticsPopulation::AllValues)
+    {
+        readAllNumbersParallel(filename, fileNumbers);
+    }
+    else if (options.ingestMode == IngestMode::Parallel)
+    {
+        readNumberFileParallel(filename, fileNumbers);
+    }
+    else if (options.ingestMode == IngestMode::AsyncIO)
+    {
+        readNumberFileAsync(filename, fileNumbers);
+    }
+    else
+    {
+        readNumberFile(filename, fileNumbers);
+    }
+}
+
+// Returns the statistics of the values in the file
+// With the exact backend the values are read into a tree as options.ingestMode says: a RedBlackTree<double>
+// for the unique values, or one keyed by (value, position in the file) for all values; with the approximate
+// backend every value is streamed through computeApproximateStatistics
+inline StatisticsResult computeStatistics(string filename, const StatisticsOptions &options = StatisticsOptions())
+{
+    if (options.backend == StatisticsBackend::Approximate)
+    {
+        return computeApproximateStatistics(filename, options);
+    }
+    if (options.population == StatisticsPopulation::AllValues)
+    {
+        // Tag each value with its position so that repeats are kept
+        RedBlackTree<std::pair<double, long long>> fileSamples;
+        long long position = 0;
+        if (options.ingestMode == IngestMode::Pipelined)
+        {
+            readNumberFilePipelined(filename, [&fileSamples, &position](const vector<double> &batch)
+                                    {
+                                        for (double value : batch)
+                                        {
+                                            fileSamples.insert(std::make_pair(value, position++));
+                                        } });
+        }
+        else
+        {
+            vector<double> fileNumbers;
+            readStatisticsValues(filename, options, fileNumbers);
+            vector<std::pair<double, long long>> samples;
+            samples.reserve(fileNumbers.size());
+            for (double value : fileNumbers)
+            {
+                samples.push_back(std::make_pair(value, position++));
+            }
+            fileSamples.buildParallel(std::move(samples));
+        }
+        return computeStatistics(fileSamples, options);
+    }
+    RedBlackTree<double> fileStatistics;
+    if (options.ingestMode == IngestMode::Pipelined)
+    {
+        // Insert each batch while the next one is being parsed
+        readNumberFilePipelined(filename, [&fileStatistics](const vector<double> &batch)
+                                {
+                                    for (double value : batch)
+                                    {
+                                        fileStatistics.insert(value);
+                                    } });
+    }
+    else
+    {
+        // Build the tree from every value read in one pass
+        vector<double> fileNumbers;
+        readStatisticsValues(filename, options, fileNumbers);
+        fileStatistics.buildParallel(std::move(fileNumbers));
+    }
+    return computeStatistics(fileStatistics, options);
+}
+
+// Prints the result in the format of statistics(), followed by any quantiles as "p99.9: value"
+inline void printStatistics(const StatisticsResult &result)
+{
+    if (!result.isSupported)
+    {
+        cout << "The approximate backend cannot count unique values." << endl;
+        return;
+    }
+    if (result.count == 0)
+    {
+        // There are no values, so the file does not contain any value
+        cout << "The file is empty." << endl;
+        return;
+    }
+    cout << "# of values: " << result.count << endl;
+    cout << "average: " << result.average << endl;
+    cout << "median: " << result.median << endl;
+    for (const StatisticsQuery &query : result.queries)
+    {
+        cout << "closest < " << query.point << ": ";
+        if (query.hasLess)
+        {
+            cout << query.closestLess << endl;
+        }
+        else
+        {
+            cout << "None" << endl;
+        }
+        cout << "closest > " << query.point << ": ";
+        if (query.hasGreater)
+        {
+            cout << query.closestGreater << endl;
+        }
+        else
+        {
+            cout << "None" << endl;
+        }
+    }
+    for (const StatisticsQuantile &quantile : result.quantiles)
+    {
+        cout << "p" << quantile.fraction * 100 << ": " << quantile.value << endl;
+    }
+}
+
+// Prints the number of unique values in the file, their average and median,
+// and the closest values below and above 42
+inline void statistics(string filename, IngestMode mode = IngestMode::Parallel)
+{
+    StatisticsOptions options;
+    options.ingestMode = mode;
+    printStatistics(computeStatistics(filename, options));
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+using std::vector;
+
+// Approximate quantiles of an unbounded stream of numbers in bounded memory (Dunning's merging t-digest)
+// Values are grouped into centroids (a mean and a weight). Centroids near the middle of the distribution
+// may hold many values, and centroids near either tail only a few. With compression δ, the centroids
+// holding the values around quantile q together cover at most a fraction 2π·sqrt(q(1 − q))/δ of the
+// stream. So the rank error of quantile q is about π·sqrt(q(1 − q))/δ: 0.8% of the values at the median
+// and 0.16% at p99 for the default δ = 200. The minimum and maximum are exact, and while every centroid
+// still holds a single value, quantiles are exact too.
+// Memory stays below about δ centroids plus a buffer of 5δ values waiting to be merged.
+// A digest is not thread-safe, even for const calls; fill one per thread and merge them
+class TDigest
+{
+    // Private attributes and helper methods
+private:
+    struct Centroid
+    {
+        double mean;
+        double weight;
+    };
+
+    double compression;
+    mutable vector<Centroid> centroids; // Sorted by mean
+    mutable vector<Centroid> buffered;  // Added since the last merge, in arrival order
+    double totalWeight;
+    double minimum;
+    double maximum;
+    double scale(double fraction) const;
+    double inverseScale(double scaledValue) const;
+    void mergeBuffered() const;
+
+    // Public methods
+public:
+    explicit TDigest(double compression = 200.0);
+    void add(double value, double weight = 1.0);
+    void merge(const TDigest &digestParameter);
+    double quantile(double fraction) const;
+    double count() const;
+    double min() const;
+    double max() const;
+    int centroidCount() const;
+};
+
+// Constructor
+// Larger compressions keep more centroids and give smaller errors
+inline TDigest::TDigest(double compression)
+    : compression(std::max(compression, 10.0)), totalWeight(0.0), minimum(0.0), maximum(0.0)
+{
+}
+
+// Maps a fraction of the stream to the scale on which each centroid may span at most 1
+inline double TDigest::scale(double fraction) const
+{
+    const double pi = std::acos(-1.0);
+    return compression / (2 * pi) * std::asin(2 * fraction - 1);
+}
+
+// Maps a point on the centroid scale back to a fraction of the stream
+inline double TDigest::inverseScale(double scaledValue) const
+{
+    const double pi = std::acos(-1.0);
+    return (std::sin(scaledValue * 2 * pi / compression) + 1) / 2;
+}
+
+// Adds a value, or weight copies of it
+inline void TDigest::add(double value, double weight)
+{
+    if (weight <= 0.0)
+    {
+        return;
+    }
+    if (totalWeight == 0.0)
+    {
+        minimum = maximum = value;
+    }
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+    totalWeight += weight;
+    buffered.push_back(Centroid{value, weight});
+    if (buffered.size() >= 5 * compression)
+    {
+        mergeBuffered();
+    }
+}
+
+// Adds every value summarised by another digest, such as one filled on another thread
+inline void TDigest::merge(const TDigest &digestParameter)
+{
+    if (digestParameter.totalWeight == 0.0)
+    {
+        return;
+    }
+    digestParameter.mergeBuffered();
+    if (totalWeight == 0.0)
+    {
+        minimum = digestParameter.minimum;
+        maximum = digestParameter.maximum;
+    }
+    minimum = std::min(minimum, digestParameter.minimum);
+    maximum = std::max(maximum, digestParameter.maximum);
+    totalWeight += digestParameter.totalWeight;
+    buffered.insert(buffered.end(), digestParameter.centroids.begin(), digestParameter.centroids.end());
+    mergeBuffered();
+}
+
+// Sorts the buffered values in with the centroids and merges neighbours for as long as the
+// merged centroid stays within one unit of the scale
+inline void TDigest::mergeBuffered() const
+{
+    if (buffered.empty())
+    {
+        return;
+    }
+    buffered.insert(buffered.end(), centroids.begin(), centroids.end());
+    std::sort(buffered.begin(), buffered.end(), [](const Centroid &first, const Centroid &second)
+              { return first.mean < second.mean; });
+    centroids.clear();
+
+    Centroid current = buffered.front();
+    double weightBefore = 0.0; // Weight of the centroids already finished
+    double fractionLimit = inverseScale(scale(0.0) + 1);
+    for (size_t i = 1; i < buffered.size(); i++)
+    {
+        const Centroid &next = buffered[i];
+        if ((weightBefore + current.weight + next.weight) / totalWeight <= fractionLimit)
+        {
+            current.mean += (next.mean - current.mean) * next.weight / (current.weight + next.weight);
+            current.weight += next.weight;
+        }
+        else
+        {
+            weightBefore += current.weight;
+            centroids.push_back(current);
+            fractionLimit = inverseScale(scale(weightBefore / totalWeight) + 1);
+            current = next;
+        }
+    }
+    centroids.push_back(current);
+    buffered.clear();
+}
+
+// Returns the approximate quantile (0 is the minimum, 0.5 the median, 1 the maximum), or 0 if the digest is empty
+// As with the exact quantiles, quantile q sits at position q·(n − 1) of the sorted values. Each centroid stands
+// at the position of its middle value, and positions between centroids are interpolated linearly
+inline double TDigest::quantile(double fraction) const
+{
+    if (totalWeight == 0.0)
+    {
+        return 0.0;
+    }
+    mergeBuffered();
+    fraction = std::min(std::max(fraction, 0.0), 1.0);
+    double position = fraction * (totalWeight - 1);
+
+    // Interpolate between (position, value) points: the minimum, each centroid's middle, then the maximum
+    double previousPosition = 0.0;
+    double previousValue = minimum;
+    double weightBefore = 0.0;
+    for (const Centroid &centroid : centroids)
+    {
+        double centroidPosition = weightBefore + (centroid.weight - 1) / 2;
+        if (position <= centroidPosition)
+        {
+            if (centroidPosition == previousPosition)
+            {
+                return centroid.mean;
+            }
+            return previousValue + (centroid.mean - previousValue) * (position - previousPosition) / (centroidPosition - previousPosition);
+        }
+        previousPosition = centroidPosition;
+        previousValue = centroid.mean;
+        weightBefore += centroid.weight;
+    }
+    double lastPosition = totalWeight - 1;
+    if (lastPosition == previousPosition)
+    {
+        return maximum;
+    }
+    return previousValue + (maximum - previousValue) * (position - previousPosition) / (lastPosition - previousPosition);
+}
+
+// Returns the number of values added, counting weights
+inline double TDigest::count() const
+{
+    return totalWeight;
+}
+
+// Returns the smallest value added, or 0 if the digest is empty
+inline double TDigest::min() const
+{
+    return minimum;
+}
+
+// Returns the largest value added, or 0 if the digest is empty
+inline double TDigest::max() const
+{
+    return maximum;
+}
+
+// Returns the number of centroids currently kept
+inline int TDigest::centroidCount() const
+{
+    mergeBuffered();
+    return centroids.size();
+}
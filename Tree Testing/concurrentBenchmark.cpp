@@ -0,0 +1,101 @@
+// Write-scaling benchmark for the concurrent trees
+// Every thread inserts and removes values in its own key region, so threads only contend
+// where their paths meet near the root. The last column repeats the lock coupling run with one more
+// thread scanning the whole tree with values() the entire time, to show scans do not stall writers.
+// Build and run with:
+//   g++ -std=c++17 -O2 -pthread concurrentBenchmark.cpp -o concurrentBenchmark && ./concurrentBenchmark
+#include "ConcurrentRedBlackTree.h"
+#include "LockCouplingRedBlackTree.h"
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int keysPerThread = 1 << 16;
+const int operationsPerThread = 200000;
+const int maxThreads = 32;
+
+// Fills every region to half of its keys, then times a mix of 25% inserts, 25% removes and 50% searches,
+// optionally while another thread keeps scanning the whole tree
+// Returns the throughput of the worker threads in millions of operations per second
+template <class Tree>
+double runWorkload(int numberOfThreads, bool withScanner = false)
+{
+    Tree tree;
+    for (int t = 0; t < maxThreads; ++t)
+    {
+        for (int i = 0; i < keysPerThread; i += 2)
+        {
+            tree.insert(t * keysPerThread + i);
+        }
+    }
+
+    atomic<bool> workersDone{false};
+    thread scanner;
+    if (withScanner)
+    {
+        scanner = thread([&tree, &workersDone]()
+                         {
+            while (!workersDone.load())
+            {
+                tree.values();
+            } });
+    }
+
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (int t = 0; t < numberOfThreads; ++t)
+    {
+        threads.push_back(thread([&tree, t]()
+                                 {
+            mt19937 generator(t);
+            uniform_int_distribution<int> keyDistribution(0, keysPerThread - 1);
+            for (int i = 0; i < operationsPerThread; ++i)
+            {
+                int value = t * keysPerThread + keyDistribution(generator);
+                switch (i % 4)
+                {
+                case 0:
+                    tree.insert(value);
+                    break;
+                case 1:
+                    tree.remove(value);
+                    break;
+                default:
+                    tree.search(value);
+                }
+            } }));
+    }
+    for (thread &workerThread : threads)
+    {
+        workerThread.join();
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    workersDone.store(true);
+    if (scanner.joinable())
+    {
+        scanner.join();
+    }
+    return numberOfThreads * operationsPerThread / elapsed.count() / 1e6;
+}
+
+int main()
+{
+    cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+    cout << setw(8) << "threads" << setw(16) << "global lock" << setw(16) << "lock coupling" << setw(16) << "with scanner"
+         << "   (Mops/s)" << endl;
+    for (int numberOfThreads = 1; numberOfThreads <= maxThreads; numberOfThreads *= 2)
+    {
+        double globalLock = runWorkload<ConcurrentRedBlackTree<int>>(numberOfThreads);
+        double lockCoupling = runWorkload<LockCouplingRedBlackTree<int>>(numberOfThreads);
+        double withScanner = runWorkload<LockCouplingRedBlackTree<int>>(numberOfThreads, true);
+        cout << setw(8) << numberOfThreads << fixed << setprecision(2)
+             << setw(16) << globalLock << setw(16) << lockCoupling << setw(16) << withScanner << endl;
+    }
+    return 0;
+}
@@ -11,9 +11,25 @@
 #endif
 
 #include "RedBlackTree.h"
+#include "BTree.h"
+#include "HybridRedBlackTree.h"
+#include "IntrusiveRedBlackTree.h"
+#include "ConcurrentRedBlackTree.h"
+#include "EpochRedBlackTree.h"
+#include "LockCouplingRedBlackTree.h"
+#include "ShardedRedBlackTree.h"
+#include "FlatCombiningRedBlackTree.h"
+#include "PersistentRedBlackTree.h"
+#include "StreamingStats.h"
+#include "SlidingWindowStats.h"
+#include "Statistics.h"
 #include <iostream>
 #include <algorithm>
 #include <random>
+#include <sstream>
+#include <deque>
+#include <thread>
+#include <numeric>
 
 using namespace std;
 
@@ -23,6 +39,18 @@ NodeT<Tjwme> *getTreeRoot(const RedBlackTree<Tjwme> &rbt)
     return rbt.root;
 }
 
+template <class Tjwme>
+const PersistentNodeT<Tjwme> *getTreeRoot(const PersistentRedBlackTree<Tjwme> &rbt)
+{
+    return rbt.root.get();
+}
+
+template <class Tjwme>
+LockedNodeT<Tjwme> *getTreeRoot(const LockCouplingRedBlackTree<Tjwme> &rbt)
+{
+    return rbt.head.children[1];
+}
+
 // Credit to @thebisqq for finding and adapting this function
 template <class T>
 static int computeBlackHeight(NodeT<T> *currNode)
@@ -60,6 +88,44 @@ static bool verifyRedNodeChildrenProperty(NodeT<T> *node)
     return true;
 }
 
+// Returns the number of nodes in the subtree, or -1 if any stored subtree size is wrong
+template <class T>
+static int verifySubtreeSizes(NodeT<T> *node)
+{
+    if (node == nullptr)
+        return 0;
+    int leftSize = verifySubtreeSizes(node->left);
+    int rightSize = verifySubtreeSizes(node->right);
+    if (leftSize == -1 || rightSize == -1 || node->subtreeSize != leftSize + rightSize + 1)
+        return -1;
+    return node->subtreeSize;
+}
+
+// Returns true if every node's sum matches a recount of its subtree's values
+static bool verifySubtreeSums(NodeT<double> *node, double &subtreeSum)
+{
+    subtreeSum = 0.0;
+    if (node == nullptr)
+        return true;
+    double leftSum = 0.0, rightSum = 0.0;
+    bool leftMatches = verifySubtreeSums(node->left, leftSum);
+    bool rightMatches = verifySubtreeSums(node->right, rightSum);
+    subtreeSum = leftSum + node->data + rightSum;
+    return leftMatches && rightMatches && node->subtreeSum == Approx(subtreeSum) && node->subtreeSquaredDeviations >= 0.0;
+}
+
+// Returns the brute-force summary of the values
+static ValueSummary summarise(const vector<double> &values)
+{
+    ValueSummary result;
+    result.count = values.size();
+    for (double value : values)
+        result.sum += value;
+    for (double value : values)
+        result.squaredDeviations += (value - result.sum / result.count) * (value - result.sum / result.count);
+    return result;
+}
+
 template <class T>
 static void validateInOrder(RedBlackTree<T> &rbt)
 {
@@ -423,6 +489,7 @@ TEST_CASE("volume random insert and remove test", "[RBT]")
             CHECK(inserted == !(find(v.begin(), v.end(), value) != v.end()));
             CHECK(computeBlackHeight(getTreeRoot(rbt)) != -1);
             CHECK(verifyRedNodeChildrenProperty(getTreeRoot(rbt)));
+            CHECK(verifySubtreeSizes(getTreeRoot(rbt)) == rbt.size());
             if (inserted)
                 v.push_back(value);
         }
@@ -453,6 +520,1720 @@ TEST_CASE("volume random insert and remove test", "[RBT]")
     }
 }
 
+// Call site written once and reused with every tree engine
+template <class Tree>
+static void checkEngineInterface(Tree &tree)
+{
+    CHECK(tree.insert(42) == true);
+    CHECK(tree.insert(71) == true);
+    CHECK(tree.insert(13) == true);
+    CHECK(tree.insert(42) == false);
+    Tree copy(tree);
+
+    CHECK(tree.remove(13) == true);
+    CHECK(tree.remove(13) == false);
+    CHECK(tree.search(42) == true);
+    CHECK(tree.search(13) == false);
+    CHECK(tree.search(50, 100) == (vector<int>){71});
+    CHECK(tree.values() == (vector<int>){42, 71});
+    CHECK(tree.closestLess(12) == 12);
+    CHECK(tree.closestLess(71) == 42);
+    CHECK(tree.closestGreater(42) == 71);
+    CHECK(tree.closestGreater(91) == 91);
+    CHECK(tree.size() == 2);
+    CHECK(copy.values() == (vector<int>){13, 42, 71});
+}
+
+TEST_CASE("compact relayout test", "[RBT]")
+{
+    RedBlackTree<int> rbt;
+    vector<int> expected;
+    for (int i = 0; i < 3000; ++i)
+        rbt.insert(rand() % 5000);
+    for (int i = 0; i < 1500; ++i)
+        rbt.remove(rand() % 5000);
+    expected = rbt.values();
+
+    // In-order layout stores consecutive values in consecutive nodes
+    rbt.compact();
+    CHECK(rbt.values() == expected);
+    CHECK(computeBlackHeight(getTreeRoot(rbt)) != -1);
+    CHECK(verifyRedNodeChildrenProperty(getTreeRoot(rbt)));
+    NodeT<int> *smallest = getTreeRoot(rbt);
+    while (smallest->left != nullptr)
+        smallest = smallest->left;
+    for (int i = 0; i < (int)expected.size(); ++i)
+        CHECK(smallest[i].data == expected[i]);
+
+    // Keep mutating a tree made of arena and heap nodes, then compact again
+    for (int i = 0; i < 3000; ++i)
+    {
+        int value = rand() % 5000;
+        if (rand() % 2 == 0)
+            rbt.remove(value);
+        else
+            rbt.insert(value);
+    }
+    expected = rbt.values();
+    RedBlackTree<int> copy(rbt);
+    rbt.compact(NodeLayout::VanEmdeBoas);
+    CHECK(rbt.values() == expected);
+    CHECK(rbt.size() == (int)expected.size());
+    CHECK(computeBlackHeight(getTreeRoot(rbt)) != -1);
+    CHECK(verifyRedNodeChildrenProperty(getTreeRoot(rbt)));
+    CHECK(getTreeRoot(rbt)->parent == nullptr);
+
+    for (int value : expected)
+    {
+        CHECK(rbt.remove(value) == true);
+        CHECK(rbt.search(value) == false);
+    }
+    CHECK(rbt.size() == 0);
+    CHECK(copy.values() == expected);
+}
+
+// Memory resource that counts the allocations it forwards to the default resource
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    int allocations = 0;
+    int deallocations = 0;
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        deallocations++;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+TEST_CASE("allocator-aware tree test", "[RBT]")
+{
+    CountingResource counter;
+    {
+        PmrRedBlackTree<int> rbt(&counter);
+        for (int i = 0; i < 100; ++i)
+            CHECK(rbt.insert(i) == true);
+        CHECK(counter.allocations == 100);
+        for (int i = 0; i < 50; ++i)
+            CHECK(rbt.remove(i * 2) == true);
+        CHECK(counter.deallocations == 50);
+        rbt.compact();
+        CHECK(counter.allocations == 101);
+        CHECK(rbt.size() == 50);
+        CHECK(rbt.closestGreater(10) == 11);
+        CHECK(rbt.getAllocator().resource() == &counter);
+
+        // Copies follow std::pmr and use the default resource
+        PmrRedBlackTree<int> copy(rbt);
+        CHECK(copy.values() == rbt.values());
+        CHECK(counter.allocations == 101);
+    }
+    CHECK(counter.deallocations == counter.allocations);
+
+    // Trees in a monotonic buffer are released with the buffer, not node by node
+    CountingResource upstream;
+    {
+        std::pmr::monotonic_buffer_resource arena(&upstream);
+        PmrRedBlackTree<double> rbt(&arena);
+        for (int i = 0; i < 1000; ++i)
+            rbt.insert(i * 0.5);
+        CHECK(rbt.size() == 1000);
+        CHECK(rbt.search(249.5) == true);
+    }
+    CHECK(upstream.allocations > 0);
+    CHECK(upstream.deallocations == upstream.allocations);
+
+    std::pmr::unsynchronized_pool_resource pool;
+    PmrRedBlackTree<string> names(&pool);
+    CHECK(names.insert("Resistor") == true);
+    CHECK(names.insert("Capacitor") == true);
+    CHECK(names.remove("Resistor") == true);
+    CHECK(names.values() == (vector<string>){"Capacitor"});
+}
+
+TEST_CASE("parallel bulk build test", "[RBT]")
+{
+    WorkStealingPool pool(4);
+    vector<int> sorted;
+    vector<int> parallelSorted;
+    for (int i = 0; i < 100000; ++i)
+        sorted.push_back(rand());
+    parallelSorted = sorted;
+    std::sort(sorted.begin(), sorted.end());
+    pool.sort(parallelSorted.begin(), parallelSorted.end());
+    CHECK(parallelSorted == sorted);
+
+    // Every size up to a few levels checks the colouring of partly filled bottom levels
+    for (int n = 0; n < 70; ++n)
+    {
+        vector<int> input;
+        for (int i = n - 1; i >= 0; --i)
+            input.push_back(i);
+        RedBlackTree<int> rbt;
+        rbt.buildParallel(input, pool);
+        CHECK(rbt.size() == n);
+        CHECK(computeBlackHeight(getTreeRoot(rbt)) != -1);
+        CHECK(verifyRedNodeChildrenProperty(getTreeRoot(rbt)));
+    }
+
+    // Large unsorted input with duplicates, merged with values already in the tree
+    RedBlackTree<int> rbt;
+    RedBlackTree<int> expected;
+    vector<int> input;
+    for (int i = 0; i < 50000; ++i)
+    {
+        int value = rand() % 60000;
+        input.push_back(value);
+        expected.insert(value);
+    }
+    for (int i = 0; i < 1000; ++i)
+    {
+        rbt.insert(-i);
+        expected.insert(-i);
+    }
+    rbt.buildParallel(input, pool);
+    CHECK(rbt.size() == expected.size());
+    CHECK(rbt.values() == expected.values());
+    CHECK(computeBlackHeight(getTreeRoot(rbt)) != -1);
+    CHECK(verifyRedNodeChildrenProperty(getTreeRoot(rbt)));
+    CHECK(getTreeRoot(rbt)->parent == nullptr);
+
+    // The built tree supports the usual updates
+    for (int i = 0; i < 5000; ++i)
+    {
+        int value = rand() % 60000;
+        CHECK(rbt.remove(value) == expected.remove(value));
+    }
+    CHECK(rbt.values() == expected.values());
+    CHECK(computeBlackHeight(getTreeRoot(rbt)) != -1);
+
+    // Non-default allocators create their nodes on the calling thread
+    CountingResource resource;
+    {
+        PmrRedBlackTree<int> pmrTree{std::pmr::polymorphic_allocator<int>(&resource)};
+        pmrTree.buildParallel(input, pool);
+        vector<int> uniqueInput = input;
+        std::sort(uniqueInput.begin(), uniqueInput.end());
+        uniqueInput.erase(std::unique(uniqueInput.begin(), uniqueInput.end()), uniqueInput.end());
+        CHECK(pmrTree.values() == uniqueInput);
+        CHECK(resource.allocations == pmrTree.size());
+    }
+    CHECK(resource.deallocations == resource.allocations);
+}
+
+TEST_CASE("work stealing pool exception test", "[RBT]")
+{
+    WorkStealingPool pool(4);
+    std::atomic<int> finished{0};
+
+    // An exception from either side reaches the caller only once the other side can no longer run
+    CHECK_THROWS_AS(pool.invoke([]()
+                                { throw std::runtime_error("left"); },
+                                [&finished]()
+                                { finished++; }),
+                    std::runtime_error);
+    CHECK_THROWS_AS(pool.invoke([&finished]()
+                                { finished++; },
+                                []()
+                                { throw std::out_of_range("right"); }),
+                    std::out_of_range);
+    try
+    {
+        pool.invoke([]()
+                    { throw std::runtime_error("left"); },
+                    []()
+                    { throw std::out_of_range("right"); });
+        FAIL("invoke did not throw");
+    }
+    catch (const std::runtime_error &error)
+    {
+        CHECK(string(error.what()) == "left");
+    }
+
+    // Deep nested forks where one leaf throws, while the rest keep running on the workers
+    std::function<void(int)> fork = [&](int depth)
+    {
+        if (depth == 0)
+        {
+            finished++;
+            return;
+        }
+        pool.invoke([&fork, depth]()
+                    { fork(depth - 1); },
+                    [&fork, depth]()
+                    {
+                        if (depth == 3)
+                            throw std::runtime_error("leaf");
+                        fork(depth - 1);
+                    });
+    };
+    for (int i = 0; i < 50; ++i)
+        CHECK_THROWS_AS(fork(10), std::runtime_error);
+
+    // The pool is still usable afterwards
+    vector<int> shuffled;
+    for (int i = 0; i < 100000; ++i)
+        shuffled.push_back((i * 7919) % 100000);
+    pool.sort(shuffled.begin(), shuffled.end());
+    CHECK(std::is_sorted(shuffled.begin(), shuffled.end()));
+}
+
+TEST_CASE("parallel export test", "[RBT]")
+{
+    WorkStealingPool pool(4);
+    RedBlackTree<int> rbt;
+    CHECK(rbt.valuesParallel(pool).empty());
+    CHECK(rbt.searchParallel(0, 10, pool).empty());
+
+    // Subtree sizes stay correct through inserts, removes, copies and compaction
+    for (int i = 0; i < 60000; ++i)
+        rbt.insert(rand() % 100000);
+    for (int i = 0; i < 20000; ++i)
+        rbt.remove(rand() % 100000);
+    CHECK(verifySubtreeSizes(getTreeRoot(rbt)) == rbt.size());
+    RedBlackTree<int> copy(rbt);
+    CHECK(verifySubtreeSizes(getTreeRoot(copy)) == copy.size());
+    copy.compact(NodeLayout::VanEmdeBoas);
+    CHECK(verifySubtreeSizes(getTreeRoot(copy)) == copy.size());
+
+    CHECK(rbt.valuesParallel(pool) == rbt.values());
+    CHECK(copy.valuesParallel(pool) == rbt.values());
+    int bounds[][2] = {{0, 100000}, {-5, 3}, {50000, 20000}, {99990, 200000}, {31337, 31337}, {-10, -1}, {100001, 100005}};
+    for (auto &bound : bounds)
+        CHECK(rbt.searchParallel(bound[0], bound[1], pool) == rbt.search(bound[0], bound[1]));
+    for (int i = 0; i < 200; ++i)
+    {
+        int lower = rand() % 100000;
+        int higher = lower + rand() % 20000;
+        CHECK(rbt.searchParallel(lower, higher, pool) == rbt.search(lower, higher));
+    }
+}
+
+TEST_CASE("parallel copy and background teardown test", "[RBT]")
+{
+    // Large enough for copying and deletion to fork onto the pool
+    RedBlackTree<int> rbt;
+    vector<int> input;
+    for (int i = 0; i < 100000; ++i)
+        input.push_back(i * 3);
+    rbt.buildParallel(input);
+    for (int i = 0; i < 100000; i += 7)
+        rbt.remove(i);
+
+    RedBlackTree<int> copy(rbt);
+    CHECK(copy.values() == rbt.values());
+    CHECK(computeBlackHeight(getTreeRoot(copy)) != -1);
+    CHECK(verifyRedNodeChildrenProperty(getTreeRoot(copy)));
+    CHECK(verifySubtreeSizes(getTreeRoot(copy)) == copy.size());
+    CHECK(getTreeRoot(copy)->parent == nullptr);
+
+    // Teardown on the reclaimer thread, for plain nodes and for a compacted arena
+    RedBlackTree<int> small;
+    small.insert(1);
+    small.setBackgroundReclamation(true);
+    small = copy;
+    CHECK(small.values() == rbt.values());
+    small.compact();
+    small.setBackgroundReclamation(true);
+    small = RedBlackTree<int>();
+    CHECK(small.size() == 0);
+    CHECK(small.values().empty());
+    small.insert(5);
+    CHECK(small.values() == vector<int>({5}));
+    {
+        RedBlackTree<int> dropped(copy);
+        dropped.setBackgroundReclamation(true);
+    }
+    BackgroundReclaimer::global().drain();
+
+    // Stateful allocators work too, as long as their resource outlives the reclaimer's work
+    CountingResource resource;
+    {
+        PmrRedBlackTree<int> pmrTree{std::pmr::polymorphic_allocator<int>(&resource)};
+        for (int i = 0; i < 1000; ++i)
+            pmrTree.insert(i);
+        pmrTree.setBackgroundReclamation(true);
+    }
+    BackgroundReclaimer::global().drain();
+    CHECK(resource.deallocations == resource.allocations);
+}
+
+TEST_CASE("order statistics and streaming stats test", "[Stats]")
+{
+    RedBlackTree<int> rbt;
+    for (int i = 0; i < 2000; ++i)
+        rbt.insert(rand() % 5000);
+    vector<int> sorted = rbt.values();
+    for (int i = 0; i < (int)sorted.size(); ++i)
+        CHECK(rbt.select(i) == sorted[i]);
+    for (int value = -1; value < 5001; value += 13)
+        CHECK(rbt.rank(value) == std::lower_bound(sorted.begin(), sorted.end(), value) - sorted.begin());
+
+    StreamingStats stats;
+    CHECK(stats.count() == 0);
+    CHECK(stats.mean() == 0.0);
+    CHECK(stats.median() == 0.0);
+    CHECK(stats.quantile(0.9) == 0.0);
+
+    // Mid-stream answers match a full re-scan of the unique values seen so far
+    vector<double> seen;
+    for (int i = 1; i <= 3000; ++i)
+    {
+        double value = (rand() % 100000) / 8.0;
+        bool isNew = std::find(seen.begin(), seen.end(), value) == seen.end();
+        CHECK(stats.add(value) == isNew);
+        if (isNew)
+            seen.push_back(value);
+        if (i % 250 == 0)
+        {
+            vector<double> unique = seen;
+            std::sort(unique.begin(), unique.end());
+            int n = unique.size();
+            double total = 0.0;
+            for (double v : unique)
+                total += v;
+            CHECK(stats.count() == n);
+            CHECK(stats.sum() == Approx(total));
+            CHECK(stats.mean() == Approx(total / n));
+            double median = n % 2 != 0 ? unique[n / 2] : (unique[(n - 1) / 2] + unique[n / 2]) / 2.0;
+            CHECK(stats.median() == median);
+            CHECK(stats.quantile(0.0) == unique.front());
+            CHECK(stats.quantile(1.0) == unique.back());
+            CHECK(stats.quantile(0.5) == Approx(median));
+            double position = 0.9 * (n - 1);
+            int lower = (int)position;
+            CHECK(stats.quantile(0.9) == Approx(unique[lower] + (unique[lower + 1] - unique[lower]) * (position - lower)));
+
+            // A batch of quantiles matches asking for each one, whether found by selects or by one traversal
+            vector<double> fractions = {0.5, 0.9, 0.99, 0.999, -1.0, 2.0};
+            vector<double> batch = stats.quantiles(fractions);
+            REQUIRE(batch.size() == fractions.size());
+            for (size_t q = 0; q < fractions.size(); ++q)
+                CHECK(batch[q] == stats.quantile(fractions[q]));
+            vector<double> manyFractions;
+            for (int q = 0; q <= n; ++q)
+                manyFractions.push_back((double)q / n);
+            batch = stats.quantiles(manyFractions);
+            bool allMatch = true;
+            for (size_t q = 0; q < manyFractions.size(); ++q)
+                allMatch = allMatch && batch[q] == Approx(stats.quantile(manyFractions[q]));
+            CHECK(allMatch);
+        }
+    }
+    CHECK(StreamingStats().quantiles({0.5, 0.99}) == vector<double>{0.0, 0.0});
+
+    // Trees with other allocators answer quantiles too
+    std::pmr::monotonic_buffer_resource arena;
+    PmrRedBlackTree<double> pmrValues(&arena);
+    for (int i = 0; i <= 100; ++i)
+        pmrValues.insert(i);
+    CHECK(quantiles(pmrValues, {0.0, 0.25, 0.5, 1.0}) == vector<double>{0.0, 25.0, 50.0, 100.0});
+
+    // A NaN fraction gives NaN instead of an index
+    double notANumber = std::numeric_limits<double>::quiet_NaN();
+    vector<double> withNaN = quantiles(pmrValues, {notANumber, 0.5});
+    CHECK(std::isnan(withNaN[0]));
+    CHECK(withNaN[1] == 50.0);
+    CHECK(std::isnan(stats.quantile(notANumber)));
+
+    // Removing values undoes them exactly
+    StreamingStats small;
+    small.add(1.0);
+    small.add(2.0);
+    small.add(10.0);
+    CHECK(small.remove(10.0) == true);
+    CHECK(small.remove(10.0) == false);
+    CHECK(small.sum() == 3.0);
+    CHECK(small.median() == 1.5);
+    CHECK(small.closestGreater(1.0) == 2.0);
+    CHECK(small.values().size() == 2);
+}
+
+TEST_CASE("number file parser test", "[Stats]")
+{
+    // parseNumbers reads exactly what a loop of `stream >> value` reads, stopping at the same token
+    vector<string> inputs = {"", "  \n", "1 2 3", "2.71828\n3.14159\n42\n", "-4.5e3\t+7 .25 -.5\r\n",
+                             "1e-310 1.7976931348623157e308", "8 abc 9", "3 inf 4", "5 nan", "6 + 7", "+-1", "0x10 2", "9,10"};
+    for (const string &input : inputs)
+    {
+        vector<double> expected;
+        std::istringstream stream(input);
+        double value;
+        while (stream >> value)
+            expected.push_back(value);
+        vector<double> parsed;
+        parseNumbers(input.data(), input.data() + input.size(), parsed);
+        CHECK(parsed == expected);
+    }
+
+    // The mapped file reader agrees with ifstream on the statistics files
+    for (int i = 1; i <= 5; ++i)
+    {
+        string filename = "testStatFile" + std::to_string(i) + ".txt";
+        vector<double> expected;
+        ifstream file(filename);
+        double value;
+        while (file >> value)
+            expected.push_back(value);
+        vector<double> parsed;
+        CHECK(readNumberFile(filename, parsed) == true);
+        CHECK(parsed == expected);
+    }
+    vector<double> missing;
+    CHECK(readNumberFile("noSuchFile.txt", missing) == false);
+    CHECK(readNumberFileParallel("noSuchFile.txt", missing) == false);
+    CHECK(missing.empty());
+
+    // Parallel chunks give the sorted, unique values of a sequential parse, including stopping at a bad token
+    WorkStealingPool pool(4);
+    for (int withBadToken = 0; withBadToken <= 1; ++withBadToken)
+    {
+        {
+            std::ofstream file("parserTestFile.txt");
+            for (int i = 0; i < 600000; ++i)
+            {
+                file << (rand() % 200000) / 4.0 << (i % 7 == 0 ? " " : "\n");
+                if (withBadToken && i == 350000)
+                    file << "bad\n";
+            }
+        }
+        vector<double> expected;
+        CHECK(readNumberFile("parserTestFile.txt", expected) == true);
+        CHECK(expected.size() == (withBadToken ? 350001u : 600000u));
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+        vector<double> parsed;
+        CHECK(readNumberFileParallel("parserTestFile.txt", parsed, pool) == true);
+        CHECK(parsed == expected);
+    }
+    std::remove("parserTestFile.txt");
+}
+
+TEST_CASE("spsc queue and statistics ingest modes test", "[Stats]")
+{
+    // Values come out in the order they went in, with the producer often finding the queue full
+    SpscQueue<int> queue(8);
+    int popped = 0;
+    CHECK(queue.tryPop(popped) == false);
+    std::thread producer([&queue]()
+                         {
+                             for (int i = 0; i < 100000; ++i)
+                                 queue.push(i); });
+    bool inOrder = true;
+    for (int i = 0; i < 100000; ++i)
+        inOrder = inOrder && queue.pop() == i;
+    producer.join();
+    CHECK(inOrder);
+    CHECK(queue.tryPop(popped) == false);
+
+    // Pipelined parsing hands over every value in file order
+    vector<double> expected, pipelined;
+    readNumberFile("testStatFile4.txt", expected);
+    CHECK(readNumberFilePipelined("testStatFile4.txt", [&pipelined](const vector<double> &batch)
+                                  { pipelined.insert(pipelined.end(), batch.begin(), batch.end()); }) == true);
+    CHECK(pipelined == expected);
+    CHECK(readNumberFilePipelined("noSuchFile.txt", [](const vector<double> &) {}) == false);
+
+    // A consumer that throws stops the parser, even with the queue full, and the exception reaches the caller
+    {
+        std::ofstream file("pipelineTestFile.txt");
+        for (int i = 0; i < 400000; ++i)
+            file << i << ' ';
+    }
+    int batchesSeen = 0;
+    CHECK_THROWS_AS(readNumberFilePipelined("pipelineTestFile.txt", [&batchesSeen](const vector<double> &)
+                                            {
+                                                if (++batchesSeen == 2)
+                                                    throw std::runtime_error("consumer failed"); }),
+                    std::runtime_error);
+    CHECK(batchesSeen == 2);
+    std::remove("pipelineTestFile.txt");
+
+    // Every ingest mode prints exactly the same statistics
+    std::streambuf *original = cout.rdbuf();
+    for (int i = 1; i <= 5; ++i)
+    {
+        string filename = "testStatFile" + std::to_string(i) + ".txt";
+        vector<string> outputs;
+        for (IngestMode mode : {IngestMode::Sequential, IngestMode::Parallel, IngestMode::Pipelined, IngestMode::AsyncIO})
+        {
+            std::ostringstream captured;
+            cout.rdbuf(captured.rdbuf());
+            statistics(filename, mode);
+            cout.rdbuf(original);
+            outputs.push_back(captured.str());
+        }
+        CHECK(outputs[0] == outputs[1]);
+        CHECK(outputs[0] == outputs[2]);
+        CHECK(outputs[0] == outputs[3]);
+    }
+}
+
+TEST_CASE("async file reader test", "[Stats]")
+{
+    {
+        std::ofstream file("asyncTestFile.txt");
+        for (int i = 0; i < 20000; ++i)
+        {
+            file << (rand() % 2000000) / 16.0 << (i % 5 == 0 ? "\t" : "\n");
+            if (i == 15000)
+                file << "x\n";
+        }
+    }
+    std::ifstream wholeFile("asyncTestFile.txt", std::ios::binary);
+    string contents((std::istreambuf_iterator<char>(wholeFile)), std::istreambuf_iterator<char>());
+
+    // Small blocks and a shallow queue so that slots are reused many times, through io_uring and through pread
+    for (bool allowIoUring : {true, false})
+    {
+        AsyncFileReader reader(4096, 4, allowIoUring);
+        string delivered;
+        CHECK(reader.read("asyncTestFile.txt", [&delivered](const char *first, const char *last)
+                          {
+                              delivered.append(first, last);
+                              return true; }) == true);
+        CHECK(delivered == contents);
+        if (!allowIoUring)
+            CHECK(reader.usedIoUring() == false);
+
+        // Stopping early delivers nothing more
+        int blocks = 0;
+        CHECK(reader.read("asyncTestFile.txt", [&blocks](const char *, const char *)
+                          { return ++blocks < 3; }) == true);
+        CHECK(blocks == 3);
+
+        // Numbers cut at block boundaries are joined back together, and parsing stops at the bad token
+        AsyncFileReader oddReader(1000, 3, allowIoUring);
+        vector<double> expected, parsed;
+        readNumberFile("asyncTestFile.txt", expected);
+        CHECK(expected.size() == 15001);
+        CHECK(readNumberFileAsync("asyncTestFile.txt", parsed, oddReader) == true);
+        CHECK(parsed == expected);
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    // A pipe has no size, so it is read a block at a time until the writer closes it
+    REQUIRE(mkfifo("asyncTestPipe", 0600) == 0);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        std::thread writer([&contents]()
+                           { std::ofstream("asyncTestPipe", std::ios::binary) << contents; });
+        vector<double> expected, parsed;
+        readNumberFile("asyncTestFile.txt", expected);
+        if (pass == 0)
+        {
+            AsyncFileReader pipeReader(1000, 3);
+            CHECK(readNumberFileAsync("asyncTestPipe", parsed, pipeReader) == true);
+            CHECK(parsed == expected);
+        }
+        else
+        {
+            StatisticsOptions approximate;
+            approximate.backend = StatisticsBackend::Approximate;
+            approximate.population = StatisticsPopulation::AllValues;
+            StatisticsResult streamed = computeStatistics("asyncTestPipe", approximate);
+            CHECK(streamed.count == (long long)expected.size());
+            CHECK(streamed.sum == Approx(std::accumulate(expected.begin(), expected.end(), 0.0)));
+        }
+        writer.join();
+    }
+    std::remove("asyncTestPipe");
+#endif
+    std::remove("asyncTestFile.txt");
+
+    AsyncFileReader reader;
+    vector<double> numbers;
+    CHECK(reader.read("noSuchFile.txt", [](const char *, const char *)
+                      { return true; }) == false);
+    CHECK(readNumberFileAsync("testStatFile5.txt", numbers) == true);
+    CHECK(numbers == vector<double>{0.0});
+}
+
+TEST_CASE("statistics result test", "[Stats]")
+{
+    StatisticsResult result = computeStatistics("testStatFile1.txt");
+    CHECK(result.count == 5);
+    CHECK(result.average == Approx(1593.4));
+    CHECK(result.median == Approx(3.14159));
+    REQUIRE(result.queries.size() == 1);
+    CHECK(result.queries[0].point == 42.0);
+    CHECK(result.queries[0].hasLess == true);
+    CHECK(result.queries[0].closestLess == Approx(3.14159));
+    CHECK(result.queries[0].hasGreater == true);
+    CHECK(result.queries[0].closestGreater == Approx(7917.5));
+
+    // Quantiles are reported and printed after the closest values
+    StatisticsOptions withQuantiles;
+    withQuantiles.quantileFractions = {0.5, 0.999};
+    result = computeStatistics("testStatFile2.txt", withQuantiles);
+    REQUIRE(result.quantiles.size() == 2);
+    CHECK(result.quantiles[0].fraction == 0.5);
+    CHECK(result.quantiles[0].value == result.median);
+    CHECK(result.quantiles[1].value == Approx(90 - 10 * 0.009));
+    std::ostringstream printed;
+    std::streambuf *original = cout.rdbuf(printed.rdbuf());
+    printStatistics(result);
+    cout.rdbuf(original);
+    CHECK(printed.str().find("closest > 42: 50\np50: 45\np99.9: 89.91\n") != string::npos);
+
+    StatisticsResult empty = computeStatistics("noSuchFile.txt");
+    CHECK(empty.count == 0);
+    CHECK(empty.queries.empty());
+
+    // Any number of query points, each answered like a scan of the sorted values would
+    RedBlackTree<double> values;
+    for (int i = 0; i < 1000; ++i)
+        values.insert((rand() % 10000) / 2.0);
+    vector<double> sorted = values.values();
+    StatisticsOptions options;
+    options.queryPoints = {-1.0, sorted.front(), 42.0, sorted[500], 2500.25, sorted.back(), 6000.0};
+    result = computeStatistics(values, options);
+    CHECK(result.count == (int)sorted.size());
+    REQUIRE(result.queries.size() == options.queryPoints.size());
+    for (const StatisticsQuery &query : result.queries)
+    {
+        auto lower = std::lower_bound(sorted.begin(), sorted.end(), query.point);
+        auto upper = std::upper_bound(sorted.begin(), sorted.end(), query.point);
+        CHECK(query.hasLess == (lower != sorted.begin()));
+        if (query.hasLess)
+            CHECK(query.closestLess == *(lower - 1));
+        CHECK(query.hasGreater == (upper != sorted.end()));
+        if (query.hasGreater)
+            CHECK(query.closestGreater == *upper);
+    }
+}
+
+TEST_CASE("sliding window stats test", "[Stats]")
+{
+    // The last 100 samples, repeats included, match a re-scan of those samples after every add
+    SlidingWindowStats lastValues(100);
+    std::deque<double> recent;
+    bool allMatch = true;
+    for (int i = 0; i < 1500; ++i)
+    {
+        double value = rand() % 300;
+        lastValues.add(value);
+        recent.push_back(value);
+        if (recent.size() > 100)
+            recent.pop_front();
+        vector<double> sorted(recent.begin(), recent.end());
+        std::sort(sorted.begin(), sorted.end());
+        int n = sorted.size();
+        double total = 0.0;
+        for (double v : sorted)
+            total += v;
+        double median = n % 2 != 0 ? sorted[n / 2] : (sorted[(n - 1) / 2] + sorted[n / 2]) / 2.0;
+        double position = 0.99 * (n - 1);
+        int lower = (int)position;
+        double p99 = lower + 1 < n ? sorted[lower] + (sorted[lower + 1] - sorted[lower]) * (position - lower) : sorted[lower];
+        auto below = std::lower_bound(sorted.begin(), sorted.end(), 150.0);
+        auto above = std::upper_bound(sorted.begin(), sorted.end(), 150.0);
+        double squaredDeviations = 0.0;
+        for (double v : sorted)
+            squaredDeviations += (v - total / n) * (v - total / n);
+        double mode = sorted[0];
+        int modeCount = 0;
+        for (int first = 0, last = 0; first < n; first = last)
+        {
+            while (last < n && sorted[last] == sorted[first])
+                ++last;
+            if (last - first > modeCount)
+            {
+                modeCount = last - first;
+                mode = sorted[first];
+            }
+        }
+        vector<double> lowHalf(sorted.begin(), std::upper_bound(sorted.begin(), sorted.end(), 150.0));
+        ValueSummary lowSummary = lastValues.summary(150.0, -1.0);
+        allMatch = allMatch && lastValues.variance() == Approx(squaredDeviations / n) && lastValues.mode() == mode &&
+                   lowSummary.count == (int)lowHalf.size() && lowSummary.sum == Approx(summarise(lowHalf).sum);
+        allMatch = allMatch && lastValues.count() == n && lastValues.sum() == total &&
+                   lastValues.median() == median && lastValues.quantile(0.99) == Approx(p99) &&
+                   lastValues.closestLess(150.0) == (below == sorted.begin() ? 150.0 : *(below - 1)) &&
+                   lastValues.closestGreater(150.0) == (above == sorted.end() ? 150.0 : *above);
+    }
+    CHECK(allMatch);
+
+    // A time window drops samples once they are older than its age, on add or on expire
+    using std::chrono::seconds;
+    std::chrono::steady_clock::time_point start;
+    SlidingWindowStats lastMinute(seconds(60));
+    CHECK(lastMinute.count() == 0);
+    CHECK(lastMinute.median() == 0.0);
+    CHECK(lastMinute.closestLess(5.0) == 5.0);
+    for (int second = 0; second < 120; ++second)
+        lastMinute.add(second, start + seconds(second));
+    CHECK(lastMinute.count() == 61);
+    CHECK(lastMinute.quantile(0.0) == 59.0);
+    CHECK(lastMinute.quantile(1.0) == 119.0);
+    CHECK(lastMinute.mean() == 89.0);
+    CHECK(lastMinute.quantiles({0.5, 1.0}) == vector<double>{89.0, 119.0});
+    lastMinute.expire(start + seconds(150));
+    CHECK(lastMinute.count() == 30);
+    CHECK(lastMinute.closestLess(90.0) == 90.0);
+    CHECK(lastMinute.closestGreater(100.0) == 101.0);
+    lastMinute.expire(start + seconds(1000));
+    CHECK(lastMinute.count() == 0);
+    CHECK(lastMinute.sum() == 0.0);
+
+    // Both limits at once
+    SlidingWindowStats both(5, seconds(10));
+    for (int second = 0; second < 20; ++second)
+        both.add(7.0, start + seconds(second));
+    CHECK(both.count() == 5);
+    CHECK(both.median() == 7.0);
+    CHECK(both.mode() == 7.0);
+    CHECK(both.standardDeviation() == 0.0);
+    both.add(1.0, start + seconds(40));
+    CHECK(both.count() == 1);
+}
+
+TEST_CASE("subtree summary test", "[Stats]")
+{
+    // Sums and spreads stay right through inserts, removes, copies, compaction and bulk builds
+    RedBlackTree<double> rbt;
+    double ignored;
+    CHECK(rbt.summary().count == 0);
+    CHECK(rbt.summary().variance() == 0.0);
+    for (int i = 0; i < 3000; ++i)
+    {
+        rbt.insert(1e6 + (rand() % 20000) / 4.0);
+        if (i % 3 == 0)
+            rbt.remove(1e6 + (rand() % 20000) / 4.0);
+    }
+    CHECK(verifySubtreeSums(getTreeRoot(rbt), ignored));
+    vector<double> values = rbt.values();
+    ValueSummary expected = summarise(values);
+    ValueSummary whole = rbt.summary();
+    CHECK(whole.count == expected.count);
+    CHECK(whole.sum == Approx(expected.sum));
+    CHECK(whole.mean() == Approx(expected.sum / expected.count));
+    CHECK(whole.variance() == Approx(expected.squaredDeviations / expected.count));
+    CHECK(whole.sampleVariance() == Approx(expected.squaredDeviations / (expected.count - 1)));
+    CHECK(whole.standardDeviation() == Approx(std::sqrt(expected.squaredDeviations / expected.count)));
+
+    // Any range, including ones that start or end between values or hold nothing
+    bool rangesMatch = true;
+    for (int i = 0; i < 200; ++i)
+    {
+        double low = 1e6 + (rand() % 21000) / 4.0 - 100, high = 1e6 + (rand() % 21000) / 4.0 - 100;
+        vector<double> inRange = rbt.search(low, high);
+        ValueSummary range = rbt.summary(high, low);
+        ValueSummary bruteForce = summarise(inRange);
+        rangesMatch = rangesMatch && range.count == bruteForce.count && range.sum == Approx(bruteForce.sum) &&
+                      range.squaredDeviations == Approx(bruteForce.squaredDeviations).margin(1e-6);
+    }
+    CHECK(rangesMatch);
+    CHECK(rbt.summary(0.0, 1.0).count == 0);
+
+    RedBlackTree<double> copy(rbt);
+    CHECK(verifySubtreeSums(getTreeRoot(copy), ignored));
+    copy.compact(NodeLayout::VanEmdeBoas);
+    CHECK(verifySubtreeSums(getTreeRoot(copy), ignored));
+    CHECK(copy.summary().variance() == Approx(whole.variance()));
+    vector<double> more;
+    for (int i = 0; i < 5000; ++i)
+        more.push_back(rand() % 1000);
+    copy.buildParallel(more);
+    CHECK(verifySubtreeSums(getTreeRoot(copy), ignored));
+    CHECK(copy.summary().variance() == Approx(summarise(copy.values()).squaredDeviations / copy.size()));
+
+    // The statistics of a file and of a stream carry the variance too
+    StatisticsResult result = computeStatistics("testStatFile2.txt");
+    CHECK(result.variance == Approx(825.0));
+    CHECK(result.standardDeviation == Approx(std::sqrt(825.0)));
+    StreamingStats stats;
+    for (double value : {2.0, 4.0, 4.0, 6.0})
+        stats.add(value);
+    CHECK(stats.variance() == Approx(8.0 / 3));
+    CHECK(stats.standardDeviation() == Approx(std::sqrt(8.0 / 3)));
+}
+
+TEST_CASE("t-digest and approximate statistics test", "[Stats]")
+{
+    TDigest empty;
+    CHECK(empty.count() == 0.0);
+    CHECK(empty.quantile(0.5) == 0.0);
+
+    // While every centroid holds one value the quantiles are exact
+    TDigest small;
+    vector<double> smallValues = {5, 1, 4, 2, 3, 9};
+    for (double value : smallValues)
+        small.add(value);
+    CHECK(small.quantile(0.0) == 1.0);
+    CHECK(small.quantile(0.5) == 3.5);
+    CHECK(small.quantile(0.2) == 2.0);
+    CHECK(small.quantile(1.0) == 9.0);
+
+    // A large stream stays within the documented rank error, in bounded memory
+    std::mt19937 generator(7);
+    std::normal_distribution<double> distribution(100.0, 15.0);
+    vector<double> stream;
+    TDigest digest, firstHalf, secondHalf;
+    for (int i = 0; i < 200000; ++i)
+    {
+        double value = distribution(generator);
+        stream.push_back(value);
+        digest.add(value);
+        (i % 2 == 0 ? firstHalf : secondHalf).add(value);
+    }
+    firstHalf.merge(secondHalf);
+    std::sort(stream.begin(), stream.end());
+    CHECK(digest.count() == 200000.0);
+    CHECK(digest.min() == stream.front());
+    CHECK(digest.max() == stream.back());
+    CHECK(digest.centroidCount() <= 200);
+    CHECK(firstHalf.count() == 200000.0);
+    CHECK(firstHalf.centroidCount() <= 200);
+    for (double fraction : {0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999})
+    {
+        double rankBound = std::acos(-1.0) * std::sqrt(fraction * (1 - fraction)) / 200;
+        for (const TDigest *sketch : {&digest, &firstHalf})
+        {
+            double rank = (std::lower_bound(stream.begin(), stream.end(), sketch->quantile(fraction)) - stream.begin()) / (double)stream.size();
+            CHECK(std::fabs(rank - fraction) <= rankBound);
+        }
+    }
+
+    // The approximate backend fills the same result; on a short file every value is its own centroid
+    StatisticsOptions approximate;
+    approximate.backend = StatisticsBackend::Approximate;
+    approximate.population = StatisticsPopulation::AllValues;
+    approximate.queryPoints = {42.0, 95.0};
+    approximate.quantileFractions = {0.9};
+    StatisticsOptions exact = approximate;
+    exact.backend = StatisticsBackend::Exact;
+    StatisticsResult estimated = computeStatistics("testStatFile2.txt", approximate);
+    StatisticsResult computed = computeStatistics("testStatFile2.txt", exact);
+    CHECK(estimated.isApproximate == true);
+    CHECK(computed.isApproximate == false);
+    CHECK(estimated.count == computed.count);
+    CHECK(estimated.sum == computed.sum);
+    CHECK(estimated.average == computed.average);
+    CHECK(estimated.median == computed.median);
+    CHECK(estimated.variance == Approx(computed.variance));
+    REQUIRE(estimated.queries.size() == 2);
+    CHECK(estimated.queries[0].closestLess == 40.0);
+    CHECK(estimated.queries[0].closestGreater == 50.0);
+    CHECK(estimated.queries[1].closestLess == 90.0);
+    CHECK(estimated.queries[1].hasGreater == false);
+    CHECK(estimated.quantiles[0].value == computed.quantiles[0].value);
+    CHECK(computeStatistics("noSuchFile.txt", approximate).count == 0);
+
+    // Repeats count only when all values are asked for, and the approximate backend rejects unique values
+    {
+        std::ofstream file("populationTestFile.txt");
+        file << "1 1 1 2 3";
+    }
+    StatisticsResult approximateAll = computeStatistics("populationTestFile.txt", approximate);
+    CHECK(approximateAll.isSupported == true);
+    CHECK(approximateAll.population == StatisticsPopulation::AllValues);
+    CHECK(approximateAll.count == 5);
+    CHECK(approximateAll.average == Approx(1.6));
+    for (IngestMode mode : {IngestMode::Sequential, IngestMode::Parallel, IngestMode::Pipelined, IngestMode::AsyncIO})
+    {
+        exact.ingestMode = mode;
+        exact.population = StatisticsPopulation::AllValues;
+        StatisticsResult exactAll = computeStatistics("populationTestFile.txt", exact);
+        CHECK(exactAll.population == StatisticsPopulation::AllValues);
+        CHECK(exactAll.count == 5);
+        CHECK(exactAll.sum == 8.0);
+        CHECK(exactAll.median == 1.0);
+        CHECK(exactAll.queries[0].closestLess == 3.0);
+        CHECK(exactAll.quantiles[0].value == approximateAll.quantiles[0].value);
+        exact.population = StatisticsPopulation::UniqueValues;
+        StatisticsResult exactUnique = computeStatistics("populationTestFile.txt", exact);
+        CHECK(exactUnique.population == StatisticsPopulation::UniqueValues);
+        CHECK(exactUnique.count == 3);
+        CHECK(exactUnique.average == 2.0);
+    }
+    approximate.population = StatisticsPopulation::UniqueValues;
+    StatisticsResult rejected = computeStatistics("populationTestFile.txt", approximate);
+    CHECK(rejected.isSupported == false);
+    CHECK(rejected.count == 0);
+    std::remove("populationTestFile.txt");
+
+    // The closest values around a point skip every repeat of it
+    RedBlackTree<std::pair<double, long long>> samples;
+    samples.buildParallel({{1.0, 0}, {2.0, 1}, {2.0, 2}, {2.0, 3}, {3.0, 4}});
+    StatisticsOptions around;
+    around.queryPoints = {2.0, 0.5};
+    StatisticsResult aroundTwo = computeStatistics(samples, around);
+    CHECK(aroundTwo.queries[0].closestLess == 1.0);
+    CHECK(aroundTwo.queries[0].closestGreater == 3.0);
+    CHECK(aroundTwo.queries[1].hasLess == false);
+    CHECK(aroundTwo.queries[1].closestGreater == 1.0);
+}
+
+TEST_CASE("BTree engine test", "[BTree]")
+{
+    RedBlackTree<int> rbt;
+    BTree<int> bt;
+    checkEngineInterface(rbt);
+    checkEngineInterface(bt);
+
+    // Small nodes split and merge often, so compare them against RedBlackTree under churn
+    const int numberOfOperations = 20000;
+    const int maxElemValue = 3000;
+    RedBlackTree<int> expected;
+    BTree<int, 16> small;
+    for (int i = 0; i < numberOfOperations; ++i)
+    {
+        int value = rand() % maxElemValue;
+        if (rand() % 3 == 0)
+            CHECK(small.remove(value) == expected.remove(value));
+        else
+            CHECK(small.insert(value) == expected.insert(value));
+    }
+    CHECK(small.size() == expected.size());
+    CHECK(small.values() == expected.values());
+    for (int i = 0; i < maxElemValue; i += 7)
+    {
+        CHECK(small.search(i) == expected.search(i));
+        CHECK(small.closestLess(i) == expected.closestLess(i));
+        CHECK(small.closestGreater(i) == expected.closestGreater(i));
+        CHECK(small.search(i, i + 100) == expected.search(i, i + 100));
+    }
+
+    BTree<int, 16> assigned;
+    assigned = small;
+    for (int value : expected.values())
+        CHECK(small.remove(value) == true);
+    CHECK(small.size() == 0);
+    CHECK(small.values().empty());
+    CHECK(assigned.values() == expected.values());
+}
+
+TEST_CASE("HybridRedBlackTree small-size test", "[Hybrid]")
+{
+    HybridRedBlackTree<int> hybrid;
+    checkEngineInterface(hybrid);
+    CHECK(hybrid.isInline());
+
+    // Grow past the inline capacity and shrink back below half of it
+    HybridRedBlackTree<int, 8> small;
+    for (int i = 0; i < 8; ++i)
+        CHECK(small.insert(i * 2) == true);
+    CHECK(small.isInline());
+    CHECK(small.insert(3) == true);
+    CHECK(small.isInline() == false);
+    CHECK(small.size() == 9);
+    HybridRedBlackTree<int, 8> copy(small);
+    for (int i = 0; i < 5; ++i)
+        CHECK(small.remove(i * 2) == true);
+    CHECK(small.isInline());
+    CHECK(small.values() == (vector<int>){3, 10, 12, 14});
+    CHECK(copy.isInline() == false);
+    CHECK(copy.size() == 9);
+
+    // Churn across the conversion threshold against a plain RedBlackTree
+    RedBlackTree<int> expected;
+    for (int value : small.values())
+        expected.insert(value);
+    for (int i = 0; i < 20000; ++i)
+    {
+        int value = rand() % 24;
+        if (rand() % 2 == 0)
+            CHECK(small.remove(value) == expected.remove(value));
+        else
+            CHECK(small.insert(value) == expected.insert(value));
+        CHECK(small.size() == expected.size());
+        CHECK(small.closestLess(value) == expected.closestLess(value));
+        CHECK(small.closestGreater(value) == expected.closestGreater(value));
+    }
+    CHECK(small.values() == expected.values());
+    CHECK(small.search(5, 15) == expected.search(15, 5));
+}
+
+// Pooled object that can sit in three intrusive trees at once
+class PooledOrder
+{
+public:
+    int price;
+    int id;
+    RedBlackTreeHook<PooledOrder> bookHook;
+    RedBlackTreeHook<PooledOrder> activeHook;
+    RedBlackTreeHook<PooledOrder> idHook;
+
+    PooledOrder(int orderPrice = 0, int orderId = 0) : price(orderPrice), id(orderId){};
+    bool operator<(const PooledOrder &other) const { return price < other.price; }
+    bool operator>(const PooledOrder &other) const { return price > other.price; }
+    bool operator<=(const PooledOrder &other) const { return price <= other.price; }
+    bool operator>=(const PooledOrder &other) const { return price >= other.price; }
+    bool operator==(const PooledOrder &other) const { return price == other.price; }
+};
+
+// Orders pooled orders by id instead of by price
+struct OrderById
+{
+    bool operator()(const PooledOrder &first, const PooledOrder &second) const { return first.id < second.id; }
+};
+
+// Returns the black height of the intrusive subtree, or -1 if it is not a valid red black tree
+template <class T, RedBlackTreeHook<T> T::*Hook>
+static int computeIntrusiveBlackHeight(T *object)
+{
+    if (object == nullptr)
+        return 0;
+    T *left = (object->*Hook).left;
+    T *right = (object->*Hook).right;
+    if (!(object->*Hook).isBlack && ((left != nullptr && !(left->*Hook).isBlack) || (right != nullptr && !(right->*Hook).isBlack)))
+        return -1;
+    if ((left != nullptr && (left->*Hook).parent != object) || (right != nullptr && (right->*Hook).parent != object))
+        return -1;
+    int leftHeight = computeIntrusiveBlackHeight<T, Hook>(left);
+    int rightHeight = computeIntrusiveBlackHeight<T, Hook>(right);
+    if (leftHeight == -1 || rightHeight == -1 || leftHeight != rightHeight)
+        return -1;
+    return leftHeight + ((object->*Hook).isBlack ? 1 : 0);
+}
+
+TEST_CASE("intrusive tree test", "[Intrusive]")
+{
+    const int poolSize = 500;
+    vector<PooledOrder> pool;
+    for (int i = 0; i < poolSize; ++i)
+        pool.push_back(PooledOrder(i));
+
+    IntrusiveRedBlackTree<PooledOrder, &PooledOrder::bookHook> book;
+    IntrusiveRedBlackTree<PooledOrder, &PooledOrder::activeHook> active;
+    RedBlackTree<int> expected;
+    for (int i = 0; i < 20000; ++i)
+    {
+        PooledOrder &order = pool[rand() % poolSize];
+        if (rand() % 2 == 0)
+            CHECK(book.remove(order) == expected.remove(order.price));
+        else
+            CHECK(book.insert(order) == expected.insert(order.price));
+        if (i % 100 == 0 && book.size() > 0)
+        {
+            PooledOrder *root = book.values()[0];
+            while (root->bookHook.parent != nullptr)
+                root = root->bookHook.parent;
+            CHECK(root->bookHook.isBlack);
+            CHECK(computeIntrusiveBlackHeight<PooledOrder, &PooledOrder::bookHook>(root) != -1);
+        }
+    }
+    CHECK(book.size() == expected.size());
+    vector<PooledOrder *> linked = book.values();
+    for (int i = 0; i < (int)linked.size(); ++i)
+        CHECK(linked[i]->price == expected.values()[i]);
+
+    // The same objects join a second tree through their other hook
+    for (PooledOrder *order : linked)
+        CHECK(active.insert(*order) == true);
+    CHECK(active.size() == book.size());
+    CHECK(active.find(linked[0]->price) == linked[0]);
+
+    // An equal object that is not linked cannot be removed in place of the linked one
+    PooledOrder stranger(linked[0]->price);
+    CHECK(book.remove(stranger) == false);
+    CHECK(book.search(stranger) == true);
+
+    PooledOrder key(250);
+    PooledOrder *less = book.closestLess(key);
+    PooledOrder *greater = book.closestGreater(key);
+    CHECK((less == nullptr ? 250 : less->price) == expected.closestLess(250));
+    CHECK((greater == nullptr ? 250 : greater->price) == expected.closestGreater(250));
+    PooledOrder low(100), high(200);
+    vector<PooledOrder *> inRange = book.search(high, low);
+    CHECK((int)inRange.size() == (int)expected.search(100, 200).size());
+
+    book.clear();
+    CHECK(book.size() == 0);
+    CHECK(linked[0]->bookHook.parent == nullptr);
+    CHECK(active.size() == (int)linked.size());
+}
+
+TEST_CASE("intrusive tree comparator test", "[Intrusive]")
+{
+    // Ids ascend while prices descend, so the two trees hold the same objects in opposite orders
+    const int poolSize = 300;
+    vector<PooledOrder> pool;
+    for (int i = 0; i < poolSize; ++i)
+        pool.push_back(PooledOrder(poolSize - i, i));
+
+    IntrusiveRedBlackTree<PooledOrder, &PooledOrder::bookHook> byPrice;
+    IntrusiveRedBlackTree<PooledOrder, &PooledOrder::idHook, OrderById> byId;
+    for (int i = 0; i < poolSize; ++i)
+    {
+        PooledOrder &order = pool[(i * 7) % poolSize];
+        CHECK(byPrice.insert(order) == true);
+        CHECK(byId.insert(order) == true);
+    }
+    CHECK(byId.insert(pool[0]) == false);
+
+    vector<PooledOrder *> priceOrder = byPrice.values();
+    vector<PooledOrder *> idOrder = byId.values();
+    REQUIRE((int)idOrder.size() == poolSize);
+    for (int i = 0; i < poolSize; ++i)
+    {
+        CHECK(idOrder[i]->id == i);
+        CHECK(priceOrder[i] == idOrder[poolSize - 1 - i]);
+    }
+    PooledOrder *root = idOrder[0];
+    while (root->idHook.parent != nullptr)
+        root = root->idHook.parent;
+    CHECK(computeIntrusiveBlackHeight<PooledOrder, &PooledOrder::idHook>(root) != -1);
+
+    // Lookups compare only the id, whatever the key's price
+    PooledOrder idKey(-1, 42);
+    CHECK(byId.find(idKey) == &pool[42]);
+    CHECK(byPrice.find(idKey) == nullptr);
+    CHECK(byId.closestLess(idKey) == &pool[41]);
+    CHECK(byId.closestGreater(idKey) == &pool[43]);
+    PooledOrder lowId(-1, 10), highId(-1, 19);
+    vector<PooledOrder *> idRange = byId.search(highId, lowId);
+    REQUIRE(idRange.size() == 10);
+    CHECK(idRange.front() == &pool[10]);
+    CHECK(idRange.back() == &pool[19]);
+
+    // Unlinking from one tree leaves the other intact
+    for (int i = 0; i < poolSize; i += 2)
+        CHECK(byId.remove(pool[i]) == true);
+    CHECK(byId.size() == poolSize / 2);
+    CHECK(byPrice.size() == poolSize);
+    CHECK(byId.find(pool[4]) == nullptr);
+    CHECK(byPrice.find(pool[4]) == &pool[4]);
+}
+
+TEST_CASE("concurrent tree test", "[Concurrent]")
+{
+    const int numberOfThreads = 4;
+    const int valuesPerThread = 2000;
+    ConcurrentRedBlackTree<int> tree;
+
+    // Each writer owns a disjoint set of values while readers search the whole range
+    vector<std::thread> threads;
+    std::atomic<int> failedChecks{0};
+    for (int t = 0; t < numberOfThreads; ++t)
+    {
+        threads.push_back(std::thread([&tree, &failedChecks, t]()
+                                      {
+            for (int i = 0; i < valuesPerThread; ++i)
+            {
+                int value = i * numberOfThreads + t;
+                if (!tree.insert(value) || !tree.search(value))
+                    failedChecks++;
+                if (i % 2 == 0 && !tree.remove(value))
+                    failedChecks++;
+            } }));
+        threads.push_back(std::thread([&tree, &failedChecks]()
+                                      {
+            for (int i = 0; i < valuesPerThread; ++i)
+            {
+                vector<int> window = tree.search(i, i + 50);
+                if (!std::is_sorted(window.begin(), window.end()))
+                    failedChecks++;
+                int less = tree.closestLess(i);
+                if (less > i)
+                    failedChecks++;
+            } }));
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    CHECK(failedChecks == 0);
+    CHECK(tree.size() == numberOfThreads * valuesPerThread / 2);
+    RedBlackTree<int> copy = tree.copy();
+    CHECK(computeBlackHeight(getTreeRoot(copy)) != -1);
+    CHECK(verifyRedNodeChildrenProperty(getTreeRoot(copy)));
+    for (int value : copy.values())
+        CHECK(value / numberOfThreads % 2 == 1);
+
+    ContentionMetrics metrics = tree.contentionMetrics();
+    CHECK(metrics.writeAcquisitions == numberOfThreads * valuesPerThread * 3 / 2);
+    CHECK(metrics.readAcquisitions >= numberOfThreads * valuesPerThread * 3);
+    tree.resetContentionMetrics();
+    CHECK(tree.contentionMetrics().readAcquisitions == 0);
+    CHECK(tree.contentionMetrics().writeAcquisitions == 0);
+}
+
+// Returns the black height of a persistent subtree, or -1 if it is not a valid red black tree
+template <class T>
+static int computePersistentBlackHeight(const PersistentNodeT<T> *node)
+{
+    if (node == nullptr)
+        return 0;
+    if (!node->isBlack && ((node->left != nullptr && !node->left->isBlack) || (node->right != nullptr && !node->right->isBlack)))
+        return -1;
+    int leftHeight = computePersistentBlackHeight(node->left);
+    int rightHeight = computePersistentBlackHeight(node->right);
+    if (leftHeight == -1 || rightHeight == -1 || leftHeight != rightHeight)
+        return -1;
+    return leftHeight + (node->isBlack ? 1 : 0);
+}
+
+TEST_CASE("path-copying operations test", "[Epoch]")
+{
+    using Ops = PersistentRedBlackOps<int, ImmediateReclaimer<int>>;
+    using Ref = Ops::Ref;
+    {
+        Ref tree;
+        RedBlackTree<int> expected;
+        for (int i = 0; i < 20000; ++i)
+        {
+            int value = rand() % 2000;
+            bool present = Ops::find(tree.get(), value) != nullptr;
+            CHECK(present == expected.search(value));
+
+            // Keep the previous version alive to check that updates never modify it
+            Ref previous = tree;
+            vector<int> previousValues;
+            if (i % 500 == 0)
+                Ops::inOrderValues(previous.get(), previousValues);
+
+            if (rand() % 2 == 0 && present)
+            {
+                tree = Ops::remove(tree, value);
+                expected.remove(value);
+            }
+            else if (!present)
+            {
+                tree = Ops::insert(tree, value);
+                expected.insert(value);
+            }
+            CHECK(computePersistentBlackHeight(tree.get()) != -1);
+            CHECK((tree.isNull() || tree->isBlack));
+            if (i % 500 == 0)
+            {
+                vector<int> unchanged;
+                Ops::inOrderValues(previous.get(), unchanged);
+                CHECK(unchanged == previousValues);
+            }
+        }
+        vector<int> treeValues;
+        Ops::inOrderValues(tree.get(), treeValues);
+        CHECK(treeValues == expected.values());
+    }
+}
+
+TEST_CASE("persistent tree copy test", "[Persistent]")
+{
+    PersistentRedBlackTree<int> tree;
+    RedBlackTree<int> expected;
+    CHECK(tree.remove(3) == false);
+    for (int i = 0; i < 5000; ++i)
+    {
+        int value = rand() % 1000;
+        if (rand() % 3 == 0)
+            CHECK(tree.remove(value) == expected.remove(value));
+        else
+            CHECK(tree.insert(value) == expected.insert(value));
+    }
+    CHECK(computePersistentBlackHeight(getTreeRoot(tree)) != -1);
+    CHECK(tree.size() == expected.size());
+    CHECK(tree.values() == expected.values());
+    CHECK(tree.search(200, 100) == expected.search(100, 200));
+    for (int value = -1; value < 1001; value += 3)
+    {
+        CHECK(tree.search(value) == expected.search(value));
+        CHECK(tree.closestLess(value) == expected.closestLess(value));
+        CHECK(tree.closestGreater(value) == expected.closestGreater(value));
+    }
+
+    // Copies share every node until one of them changes, and never see each other's updates
+    PersistentRedBlackTree<int> copy(tree);
+    CHECK(copy.sharesStructureWith(tree));
+    PersistentRedBlackTree<int> assigned;
+    assigned.insert(-1);
+    assigned = copy;
+    CHECK(assigned.sharesStructureWith(tree));
+    vector<int> original = tree.values();
+    for (int i = 0; i < 1000; ++i)
+    {
+        copy.insert(1000 + i);
+        assigned.remove(i);
+    }
+    CHECK(!copy.sharesStructureWith(tree));
+    CHECK(tree.values() == original);
+    CHECK(copy.size() == tree.size() + 1000);
+    CHECK(assigned.size() == 0);
+    CHECK(computePersistentBlackHeight(getTreeRoot(copy)) != -1);
+    CHECK(computePersistentBlackHeight(getTreeRoot(assigned)) != -1);
+}
+
+TEST_CASE("epoch tree lock-free reader test", "[Epoch]")
+{
+    EpochRedBlackTree<int> tree;
+    CHECK(tree.insert(42) == true);
+    CHECK(tree.insert(42) == false);
+    CHECK(tree.closestLess(42) == 42);
+    CHECK(tree.remove(42) == true);
+    CHECK(tree.remove(42) == false);
+    CHECK(tree.size() == 0);
+
+    // One writer churns odd values while readers check that even values never disappear
+    const int maxValue = 4000;
+    for (int i = 0; i < maxValue; i += 2)
+        CHECK(tree.insert(i) == true);
+    std::atomic<bool> writerDone{false};
+    std::atomic<int> failedChecks{0};
+    std::thread writer([&tree, &writerDone]()
+                       {
+        for (int round = 0; round < 4; ++round)
+        {
+            for (int i = 1; i < maxValue; i += 2)
+                tree.insert(i);
+            for (int i = 1; i < maxValue; i += 2)
+                tree.remove(i);
+        }
+        writerDone = true; });
+    vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r)
+    {
+        readers.push_back(std::thread([&tree, &writerDone, &failedChecks]()
+                                      {
+            int i = 0;
+            while (!writerDone)
+            {
+                int value = (i++ * 2) % maxValue;
+                if (!tree.search(value))
+                    failedChecks++;
+                if (tree.closestGreater(value) <= value && value != maxValue - 2)
+                    failedChecks++;
+                vector<int> window = tree.search(value, value + 20);
+                if (window.empty() || window[0] != value || !std::is_sorted(window.begin(), window.end()))
+                    failedChecks++;
+            } }));
+    }
+    writer.join();
+    for (std::thread &reader : readers)
+        reader.join();
+
+    CHECK(failedChecks == 0);
+    CHECK(tree.size() == maxValue / 2);
+    vector<int> evens;
+    for (int i = 0; i < maxValue; i += 2)
+        evens.push_back(i);
+    CHECK(tree.values() == evens);
+    EpochDomain::global().reclaim();
+    EpochDomain::global().reclaim();
+    CHECK(EpochDomain::global().pendingCount() == 0);
+}
+
+TEST_CASE("epoch tree snapshot test", "[Epoch]")
+{
+    EpochRedBlackTree<int> tree;
+    for (int i = 0; i < 1000; ++i)
+        tree.insert(i);
+    RedBlackTreeSnapshot<int> before = tree.snapshot();
+
+    // Writers keep going while the snapshot is read
+    std::thread writer([&tree]()
+                       {
+        for (int i = 0; i < 1000; i += 2)
+            tree.remove(i);
+        for (int i = 1000; i < 2000; ++i)
+            tree.insert(i); });
+    int visited = 0;
+    int previous = -1;
+    bool inOrder = true;
+    for (int round = 0; round < 20; ++round)
+    {
+        before.forEach([&visited, &previous, &inOrder](int value)
+                       {
+            inOrder = inOrder && value == previous + 1;
+            previous = value;
+            visited++; });
+        previous = -1;
+    }
+    writer.join();
+
+    CHECK(inOrder);
+    CHECK(visited == 20 * 1000);
+    CHECK(before.size() == 1000);
+    CHECK(before.values().size() == 1000);
+    CHECK(before.search(0) == true);
+    CHECK(before.search(1500) == false);
+    CHECK(before.closestGreater(999) == 999);
+    CHECK(before.search(10, 12) == vector<int>({10, 11, 12}));
+
+    RedBlackTreeSnapshot<int> after = tree.snapshot();
+    RedBlackTreeSnapshot<int> afterCopy = after;
+    CHECK(after.size() == 1500);
+    CHECK(afterCopy.search(0) == false);
+    CHECK(afterCopy.closestLess(2) == 1);
+    CHECK(after.values() == tree.values());
+}
+
+// Returns the black height of a lock-coupled subtree, or -1 if it is not a valid red black tree
+template <class T>
+static int computeLockedBlackHeight(const LockedNodeT<T> *node)
+{
+    if (node == nullptr)
+        return 0;
+    const LockedNodeT<T> *left = node->children[0];
+    const LockedNodeT<T> *right = node->children[1];
+    if (!node->isBlack && ((left != nullptr && !left->isBlack) || (right != nullptr && !right->isBlack)))
+        return -1;
+    if ((left != nullptr && !(left->data < node->data)) || (right != nullptr && !(node->data < right->data)))
+        return -1;
+    int leftHeight = computeLockedBlackHeight(left);
+    int rightHeight = computeLockedBlackHeight(right);
+    if (leftHeight == -1 || rightHeight == -1 || leftHeight != rightHeight)
+        return -1;
+    return leftHeight + (node->isBlack ? 1 : 0);
+}
+
+TEST_CASE("lock coupling tree test", "[LockCoupling]")
+{
+    // Single threaded, the top-down algorithms must agree with the bottom-up tree
+    {
+        LockCouplingRedBlackTree<int> tree;
+        RedBlackTree<int> expected;
+        CHECK(tree.remove(1) == false);
+        for (int i = 0; i < 20000; ++i)
+        {
+            int value = rand() % 3000;
+            if (rand() % 3 == 0)
+                CHECK(tree.remove(value) == expected.remove(value));
+            else
+                CHECK(tree.insert(value) == expected.insert(value));
+            if (i % 1000 == 0)
+                CHECK(computeLockedBlackHeight(getTreeRoot(tree)) != -1);
+        }
+        CHECK(computeLockedBlackHeight(getTreeRoot(tree)) != -1);
+        CHECK(tree.size() == expected.size());
+        CHECK(tree.values() == expected.values());
+        CHECK(tree.search(100, 400) == expected.search(400, 100));
+        for (int value = -1; value < 3001; value += 7)
+        {
+            CHECK(tree.search(value) == expected.search(value));
+            CHECK(tree.closestLess(value) == expected.closestLess(value));
+            CHECK(tree.closestGreater(value) == expected.closestGreater(value));
+        }
+    }
+
+    // Writers in disjoint key regions run alongside readers
+    const int numberOfThreads = 4;
+    const int valuesPerThread = 2000;
+    const int anchorCount = 100;
+    LockCouplingRedBlackTree<int> tree;
+    for (int i = 1; i <= anchorCount; ++i)
+        tree.insert(-i);
+    vector<std::thread> threads;
+    std::atomic<int> failedChecks{0};
+
+    // Full scans run alongside the writers and must always see the untouched anchors in order
+    threads.push_back(std::thread([&tree, &failedChecks]()
+                                  {
+        for (int i = 0; i < 20; ++i)
+        {
+            vector<int> scanned = tree.values();
+            if (!std::is_sorted(scanned.begin(), scanned.end()) || std::adjacent_find(scanned.begin(), scanned.end()) != scanned.end())
+                failedChecks++;
+            if ((int)scanned.size() < anchorCount || scanned[0] != -anchorCount || scanned[anchorCount - 1] != -1)
+                failedChecks++;
+        } }));
+    for (int t = 0; t < numberOfThreads; ++t)
+    {
+        threads.push_back(std::thread([&tree, &failedChecks, t]()
+                                      {
+            for (int i = 0; i < valuesPerThread; ++i)
+            {
+                int value = t * valuesPerThread + i;
+                if (!tree.insert(value) || !tree.search(value))
+                    failedChecks++;
+                if (i % 2 == 0 && !tree.remove(value))
+                    failedChecks++;
+            } }));
+        threads.push_back(std::thread([&tree, &failedChecks]()
+                                      {
+            for (int i = 0; i < valuesPerThread; ++i)
+            {
+                vector<int> window = tree.search(i, i + 50);
+                if (!std::is_sorted(window.begin(), window.end()))
+                    failedChecks++;
+                if (tree.closestGreater(i) < i)
+                    failedChecks++;
+            } }));
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    for (int i = 1; i <= anchorCount; ++i)
+        CHECK(tree.remove(-i) == true);
+
+    CHECK(failedChecks == 0);
+    CHECK(tree.size() == numberOfThreads * valuesPerThread / 2);
+    CHECK(computeLockedBlackHeight(getTreeRoot(tree)) != -1);
+    vector<int> odds;
+    for (int i = 1; i < numberOfThreads * valuesPerThread; i += 2)
+        odds.push_back(i);
+    CHECK(tree.values() == odds);
+}
+
+TEST_CASE("sharded tree test", "[Sharded]")
+{
+    ShardedRedBlackTree<int> tree({1000, 2000, 3000});
+    RedBlackTree<int> expected;
+    CHECK(tree.shardCount() == 4);
+    CHECK(tree.closestLess(5) == 5);
+    for (int i = 0; i < 10000; ++i)
+    {
+        int value = rand() % 4000;
+        if (rand() % 3 == 0)
+            CHECK(tree.remove(value) == expected.remove(value));
+        else
+            CHECK(tree.insert(value) == expected.insert(value));
+    }
+    CHECK(tree.size() == expected.size());
+    CHECK(tree.values() == expected.values());
+    CHECK(tree.search(2500, 500) == expected.search(500, 2500));
+    for (int value = -1; value < 4001; value += 7)
+    {
+        CHECK(tree.search(value) == expected.search(value));
+        CHECK(tree.closestLess(value) == expected.closestLess(value));
+        CHECK(tree.closestGreater(value) == expected.closestGreater(value));
+    }
+
+    // Skewed data ends up evenly spread once the boundaries are rebalanced
+    ShardedRedBlackTree<int> skewed({100, 200, 300});
+    for (int i = 1000; i < 5000; ++i)
+        skewed.insert(i);
+    CHECK(skewed.shardSizes() == vector<int>({0, 0, 0, 4000}));
+    skewed.rebalance();
+    CHECK(skewed.shardSizes() == vector<int>({1000, 1000, 1000, 1000}));
+    CHECK(skewed.shardBoundaries() == vector<int>({2000, 3000, 4000}));
+    CHECK(skewed.rebalance({1}) == false);
+    CHECK(skewed.rebalance({4500, 1500, 2500}) == true);
+    CHECK(skewed.shardSizes() == vector<int>({500, 1000, 2000, 500}));
+    CHECK(skewed.size() == 4000);
+
+    // Moving one boundary only moves values between its two neighbours
+    CHECK(skewed.rebalance({1500, 3000, 4500}) == true);
+    CHECK(skewed.shardSizes() == vector<int>({500, 1500, 1500, 500}));
+    CHECK(skewed.rebalance({1500, 2000, 4500}) == true);
+    CHECK(skewed.shardSizes() == vector<int>({500, 500, 2500, 500}));
+    vector<int> allValues;
+    for (int i = 1000; i < 5000; ++i)
+        allValues.push_back(i);
+    CHECK(skewed.values() == allValues);
+    CHECK(skewed.search(1999, 2001) == vector<int>({1999, 2000, 2001}));
+
+    // Readers of unchanging contents always get exact answers while the boundaries keep moving
+    {
+        std::atomic<bool> rebalancing{true};
+        std::atomic<int> wrongAnswers{0};
+        std::thread rebalancer([&skewed, &rebalancing]()
+                               {
+            for (int i = 0; i < 200; ++i)
+            {
+                if (i % 2 == 0)
+                    skewed.rebalance({1200 + i, 2600, 3900 - i});
+                else
+                    skewed.rebalance();
+            }
+            rebalancing = false; });
+        while (rebalancing)
+        {
+            int value = 1000 + rand() % 4000;
+            if (!skewed.search(value) || skewed.closestLess(value + 1) != value || skewed.closestGreater(value - 1) != value)
+                wrongAnswers++;
+            if (skewed.search(value, value + 99).size() != (size_t)std::min(100, 5000 - value))
+                wrongAnswers++;
+        }
+        rebalancer.join();
+        CHECK(wrongAnswers == 0);
+        CHECK(skewed.values() == allValues);
+    }
+
+    // Writers in different shards run alongside a rebalancing thread
+    const int numberOfThreads = 4;
+    const int valuesPerThread = 2000;
+    ShardedRedBlackTree<int> concurrent({2000, 4000, 6000});
+    vector<std::thread> threads;
+    std::atomic<int> failedChecks{0};
+    for (int t = 0; t < numberOfThreads; ++t)
+    {
+        threads.push_back(std::thread([&concurrent, &failedChecks, t]()
+                                      {
+            for (int i = 0; i < valuesPerThread; ++i)
+            {
+                int value = t * valuesPerThread + i;
+                if (!concurrent.insert(value) || !concurrent.search(value))
+                    failedChecks++;
+                if (i % 2 == 0 && !concurrent.remove(value))
+                    failedChecks++;
+            } }));
+    }
+    threads.push_back(std::thread([&concurrent, &failedChecks]()
+                                  {
+        for (int i = 0; i < 20; ++i)
+        {
+            concurrent.rebalance();
+            vector<int> window = concurrent.search(1000, 7000);
+            if (!std::is_sorted(window.begin(), window.end()))
+                failedChecks++;
+        } }));
+    for (std::thread &thread : threads)
+        thread.join();
+
+    CHECK(failedChecks == 0);
+    vector<int> odds;
+    for (int i = 1; i < numberOfThreads * valuesPerThread; i += 2)
+        odds.push_back(i);
+    CHECK(concurrent.values() == odds);
+}
+
+TEST_CASE("flat combining tree test", "[FlatCombining]")
+{
+    FlatCombiningRedBlackTree<int> tree;
+    CHECK(tree.insert(7) == true);
+    CHECK(tree.insert(7) == false);
+    CHECK(tree.remove(7) == true);
+    CHECK(tree.remove(7) == false);
+
+    // Many writers with disjoint values, plus readers
+    const int numberOfThreads = 8;
+    const int valuesPerThread = 1000;
+    vector<std::thread> threads;
+    std::atomic<int> failedChecks{0};
+    for (int t = 0; t < numberOfThreads; ++t)
+    {
+        threads.push_back(std::thread([&tree, &failedChecks, t]()
+                                      {
+            for (int i = 0; i < valuesPerThread; ++i)
+            {
+                int value = i * numberOfThreads + t;
+                if (!tree.insert(value) || tree.insert(value) || !tree.search(value))
+                    failedChecks++;
+                if (i % 2 == 0 && !tree.remove(value))
+                    failedChecks++;
+            } }));
+    }
+    threads.push_back(std::thread([&tree, &failedChecks]()
+                                  {
+        for (int i = 0; i < 1000; ++i)
+        {
+            vector<int> window = tree.search(i, i + 100);
+            if (!std::is_sorted(window.begin(), window.end()))
+                failedChecks++;
+        } }));
+    for (std::thread &thread : threads)
+        thread.join();
+
+    CHECK(failedChecks == 0);
+    CHECK(tree.size() == numberOfThreads * valuesPerThread / 2);
+    for (int value : tree.values())
+        CHECK(value / numberOfThreads % 2 == 1);
+
+    CombiningStatistics statistics = tree.combiningStatistics();
+    CHECK(statistics.operations == 4 + numberOfThreads * valuesPerThread * 5 / 2);
+    CHECK(statistics.batches >= 4);
+    CHECK(statistics.batches <= statistics.operations);
+}
+
 TEST_CASE("zzz statistics test", "[RBT]")
 {
     cout << endl
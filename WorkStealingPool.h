@@ -0,0 +1,297 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::vector;
+
+// Fork-join thread pool with one task deque per worker
+// A worker pushes the tasks it forks onto the back of its own deque and pops them from the back
+// again (newest first, which keeps the data it just touched in cache); idle workers steal from
+// the front of other deques, which holds the oldest and therefore largest pieces of work.
+// A thread waiting for a forked task runs other tasks meanwhile, so nested forks never deadlock
+class WorkStealingPool
+{
+    // Private attributes and helper methods
+private:
+    struct Task
+    {
+        std::function<void()> work;
+        std::exception_ptr error; // Set if work threw, for the thread that forked the task to rethrow
+        std::atomic<bool> done{false};
+    };
+
+    struct alignas(64) TaskQueue
+    {
+        std::mutex queueMutex;
+        std::deque<Task *> tasks;
+    };
+
+    vector<std::thread> workers;
+    std::unique_ptr<TaskQueue[]> queues; // One per worker, plus a shared one for threads outside the pool
+    int queueCount;
+    std::atomic<int> queuedTasks{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    int currentQueue();
+    void push(Task *task);
+    Task *pop(int queueIndex);
+    Task *steal(int thiefIndex);
+    bool withdraw(Task *task, int queueIndex);
+    bool runOne(int queueIndex);
+    void workerLoop(int workerIndex);
+
+    // Public methods
+public:
+    explicit WorkStealingPool(int threadCount = std::thread::hardware_concurrency());
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+    ~WorkStealingPool();
+    static WorkStealingPool &global();
+    int threadCount() const;
+    template <class Left, class Right>
+    void invoke(Left &&left, Right &&right);
+    template <class RandomIterator>
+    void sort(RandomIterator first, RandomIterator last);
+};
+
+// Constructor
+// Starts the given number of workers (at least one)
+inline WorkStealingPool::WorkStealingPool(int threadCount)
+{
+    threadCount = std::max(threadCount, 1);
+    queueCount = threadCount + 1;
+    queues.reset(new TaskQueue[queueCount]);
+    for (int i = 0; i < threadCount; i++)
+    {
+        workers.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+    }
+}
+
+// Destructor
+// Waits for the workers to finish; no task may still be outstanding
+inline WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// Returns the process-wide pool, with one worker per hardware thread
+// It is never destroyed, so trees torn down during static destruction can still use it
+inline WorkStealingPool &WorkStealingPool::global()
+{
+    static WorkStealingPool *pool = new WorkStealingPool();
+    return *pool;
+}
+
+// Returns the number of workers
+inline int WorkStealingPool::threadCount() const
+{
+    return workers.size();
+}
+
+// Returns the calling thread's deque: its own for a worker of this pool, the shared one otherwise
+inline int WorkStealingPool::currentQueue()
+{
+    thread_local WorkStealingPool *ownerPool = nullptr;
+    thread_local int ownerQueue = 0;
+    if (ownerPool == this)
+    {
+        return ownerQueue;
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        if (workers[i].get_id() == std::this_thread::get_id())
+        {
+            ownerPool = this;
+            ownerQueue = i;
+            return ownerQueue;
+        }
+    }
+    return queueCount - 1;
+}
+
+// Adds the task to the back of the calling thread's deque and wakes a sleeping worker
+inline void WorkStealingPool::push(Task *task)
+{
+    TaskQueue &queue = queues[currentQueue()];
+    {
+        std::lock_guard<std::mutex> guard(queue.queueMutex);
+        queue.tasks.push_back(task);
+    }
+    queuedTasks.fetch_add(1);
+    {
+        // Taking the mutex orders the count update before a worker's check of it
+        std::lock_guard<std::mutex> guard(sleepMutex);
+    }
+    wakeUp.notify_one();
+}
+
+// Takes the newest task from the given deque, or returns nullptr if it is empty
+inline WorkStealingPool::Task *WorkStealingPool::pop(int queueIndex)
+{
+    TaskQueue &queue = queues[queueIndex];
+    std::lock_guard<std::mutex> guard(queue.queueMutex);
+    if (queue.tasks.empty())
+    {
+        return nullptr;
+    }
+    Task *task = queue.tasks.back();
+    queue.tasks.pop_back();
+    queuedTasks.fetch_sub(1);
+    return task;
+}
+
+// Takes the oldest task from another deque, or returns nullptr if every deque is empty
+inline WorkStealingPool::Task *WorkStealingPool::steal(int thiefIndex)
+{
+    for (int offset = 1; offset < queueCount; offset++)
+    {
+        TaskQueue &queue = queues[(thiefIndex + offset) % queueCount];
+        std::lock_guard<std::mutex> guard(queue.queueMutex);
+        if (!queue.tasks.empty())
+        {
+            Task *task = queue.tasks.front();
+            queue.tasks.pop_front();
+            queuedTasks.fetch_sub(1);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+// Takes the task back out of the given deque if no thread has started it yet
+// Returns true if it was withdrawn, false if it had already been taken
+inline bool WorkStealingPool::withdraw(Task *task, int queueIndex)
+{
+    TaskQueue &queue = queues[queueIndex];
+    std::lock_guard<std::mutex> guard(queue.queueMutex);
+    auto position = std::find(queue.tasks.begin(), queue.tasks.end(), task);
+    if (position == queue.tasks.end())
+    {
+        return false;
+    }
+    queue.tasks.erase(position);
+    queuedTasks.fetch_sub(1);
+    return true;
+}
+
+// Runs one task from the given deque or stolen from another
+// Returns false if there was nothing to run
+inline bool WorkStealingPool::runOne(int queueIndex)
+{
+    Task *task = pop(queueIndex);
+    if (task == nullptr)
+    {
+        task = steal(queueIndex);
+    }
+    if (task == nullptr)
+    {
+        return false;
+    }
+    try
+    {
+        task->work();
+    }
+    catch (...)
+    {
+        task->error = std::current_exception();
+    }
+    task->done.store(true, std::memory_order_release);
+    return true;
+}
+
+// Runs tasks until the pool is destroyed, sleeping while there are none
+inline void WorkStealingPool::workerLoop(int workerIndex)
+{
+    while (true)
+    {
+        if (runOne(workerIndex))
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this]()
+                    { return stopping || queuedTasks.load() > 0; });
+        if (stopping)
+        {
+            return;
+        }
+    }
+}
+
+// Runs left and right, possibly in parallel, and returns once both have finished
+// right is offered to the other workers while the calling thread runs left
+// If either throws, the exception is rethrown here once right can no longer run (left's first if both
+// throw); a right that has not started when left throws is withdrawn instead of run
+template <class Left, class Right>
+void WorkStealingPool::invoke(Left &&left, Right &&right)
+{
+    Task rightTask;
+    rightTask.work = std::ref(right);
+    int queueIndex = currentQueue();
+    push(&rightTask);
+    std::exception_ptr leftError;
+    try
+    {
+        left();
+    }
+    catch (...)
+    {
+        leftError = std::current_exception();
+        if (withdraw(&rightTask, queueIndex))
+        {
+            std::rethrow_exception(leftError);
+        }
+    }
+
+    // Help with other work until right is done, whether this thread or a thief ran it;
+    // rightTask lives on this stack, so it must not be left behind in a deque
+    while (!rightTask.done.load(std::memory_order_acquire))
+    {
+        if (!runOne(queueIndex))
+        {
+            std::this_thread::yield();
+        }
+    }
+    if (leftError)
+    {
+        std::rethrow_exception(leftError);
+    }
+    if (rightTask.error)
+    {
+        std::rethrow_exception(rightTask.error);
+    }
+}
+
+// Sorts the range, sorting halves in parallel and merging them
+template <class RandomIterator>
+void WorkStealingPool::sort(RandomIterator first, RandomIterator last)
+{
+    const long sequentialCutoff = 1 << 14;
+    if (last - first <= sequentialCutoff)
+    {
+        std::sort(first, last);
+        return;
+    }
+    RandomIterator middle = first + (last - first) / 2;
+    invoke([this, first, middle]()
+           { sort(first, middle); },
+           [this, middle, last]()
+           { sort(middle, last); });
+    std::inplace_merge(first, middle, last);
+}